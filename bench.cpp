@@ -0,0 +1,841 @@
+
+// Micro-benchmarks for the casting and simulation kernels.
+//
+// usage: labyrinth_bench [--filter NAME] [--sizes 100,400] [--radii 15,30,60] [--densities 0.05,0.25] [--min-time SECONDS] [--threads N] [--tile CELLS]
+//        labyrinth_bench --verify RADIUS
+//
+// --verify checks the kernels that have a simpler reference version against it, for every case out to RADIUS, instead of timing anything.
+// It also checks that the tiled cellular automaton updates keep to the rules of the serial ones.
+//
+// Every benchmark builds its own world, so the test map doesn't matter here.
+// Reports nanoseconds per operation, and bytes and allocations per operation counted by a replaced global operator new.
+// Configure with -DCMAKE_BUILD_TYPE=Release for numbers worth comparing.
+
+#include "world.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+std::atomic<long long> allocated_bytes(0);
+std::atomic<long long> allocation_count(0);
+
+void* operator new(std::size_t size)
+{
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+struct BenchResult
+{
+  double ns_per_op = 0;
+  double bytes_per_op = 0;
+  double allocs_per_op = 0;
+};
+
+double min_seconds = 0.2;
+
+// Runs setup (untimed) then op (timed) until min_seconds of op time have gone by.
+// op does ops_per_call operations each time it is called.
+BenchResult measure(std::function<void()> setup, std::function<void()> op, int ops_per_call = 1)
+{
+  double seconds = 0;
+  long long bytes = 0;
+  long long allocs = 0;
+  long long ops = 0;
+  // one untimed run first, so lazily built tables and reused buffers don't count against the steady state
+  setup();
+  op();
+  while (seconds < min_seconds || ops == 0)
+  {
+    setup();
+    long long bytes_before = allocated_bytes.load();
+    long long allocs_before = allocation_count.load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    op();
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bytes += allocated_bytes.load() - bytes_before;
+    allocs += allocation_count.load() - allocs_before;
+    ops += ops_per_call;
+  }
+  BenchResult result;
+  result.ns_per_op = seconds * 1e9 / ops;
+  result.bytes_per_op = static_cast<double>(bytes) / ops;
+  result.allocs_per_op = static_cast<double>(allocs) / ops;
+  return result;
+}
+
+void printHeader()
+{
+  printf("%-30s %6s %6s %8s %14s %14s %10s\n", "benchmark", "size", "radius", "density", "ns/op", "bytes/op", "allocs/op");
+}
+
+void printResult(const char* name, int size, int radius, double density, BenchResult result)
+{
+  char radius_text[16] = "-";
+  if (radius > 0)
+  {
+    snprintf(radius_text, sizeof(radius_text), "%d", radius);
+  }
+  printf("%-30s %6d %6s %8.3f %14.1f %14.1f %10.2f\n", name, size, radius_text, density, result.ns_per_op, result.bytes_per_op, result.allocs_per_op);
+  fflush(stdout);
+}
+
+// A fresh world of one open board with the player in the middle
+void resetWorld(int size)
+{
+  seedWorld(1);
+  boards.clear();
+  player_sight_lines.clear();
+  // the old sight cache points at boards that are gone, and board ids get reused
+  sight_cache = SightCache();
+  pursuit_field = PursuitField();
+  entity_store = EntityStore();
+  // lines cast outside of tickWorld pile up in the arena until something resets it
+  line_arena.reset();
+  player_board = addBoard(size);
+  player_pos = vect2Di(size/2, size/2);
+  player_faced_direction = RIGHT;
+  player_transform = IDENTITY;
+  consecutive_laser_rounds = 0;
+}
+
+// Calls fill for roughly density of the interior squares, the same ones every time for a given seed
+void scatter(BoardId board, double density, unsigned seed, std::function<void(vect2Di, std::mt19937&)> fill)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> chance(0, 1);
+  for (int x = 1; x < board->width - 1; x++)
+  {
+    for (int y = 1; y < board->height - 1; y++)
+    {
+      vect2Di pos(x, y);
+      if (pos != player_pos && chance(rng) < density)
+      {
+        fill(pos, rng);
+      }
+    }
+  }
+}
+
+void scatterWalls(double density)
+{
+  scatter(player_board, density, 1, [](vect2Di pos, std::mt19937&) { player_board->setWall(pos, true); });
+}
+
+// Vertical portal seams every few columns, each shifting you along the board
+void addPortalSeams()
+{
+  int size = player_board->width;
+  for (int x = 4; x + 3 < size - 1; x += 8)
+  {
+    for (int y = 1; y < size - 1; y++)
+    {
+      makePortalPair(player_board, vect2Di(x, y), player_board, vect2Di(x + 3, (y + 5) % (size - 2) + 1));
+    }
+  }
+}
+
+// The ends of every sight line at a given radius
+std::vector<vect2Di> ringEndpoints(int radius)
+{
+  std::vector<vect2Di> ends;
+  for (int i = -radius; i < radius; i++)
+  {
+    ends.push_back(vect2Di(radius, i));
+    ends.push_back(vect2Di(-i, radius));
+    ends.push_back(vect2Di(-radius, -i));
+    ends.push_back(vect2Di(i, -radius));
+  }
+  return ends;
+}
+
+// orthogonalBresneham as it was before it went over to integers, stepping a double and rounding it.
+// It has to come out exactly the same, tie-breaks and all, since the shapes of sight lines and lasers are part of the game.
+std::vector<vect2Di> doubleOrthogonalBresneham(vect2Di goal_pos)
+{
+  std::vector<vect2Di> output;
+  const int num_steps = std::max(std::abs(goal_pos.x), std::abs(goal_pos.y));
+  vect2Di pos;
+  double x=0;
+  double y=0;
+  double dx = static_cast<double>(goal_pos.x)/static_cast<double>(num_steps);
+  double dy = static_cast<double>(goal_pos.y)/static_cast<double>(num_steps);
+  output.push_back(pos);
+  for (int step_num = 0; step_num < num_steps; step_num++)
+  {
+    double next_x = x+dx;
+    double next_y = y+dy;
+    vect2Di next_pos = vect2Di(static_cast<int>(std::round(next_x)), static_cast<int>(std::round(next_y)));
+    if (std::abs(next_pos.x - pos.x) + std::abs(next_pos.y - pos.y) > 1)
+    {
+      double y_division = std::round(std::min(y, next_y)) + 0.5;
+      double x_division = std::round(std::min(x, next_x)) + 0.5;
+      double step_slope = (next_y - y)/(next_x - x);
+      double y_at_x_division = y + step_slope * (x_division - x);
+      if ((next_y > y && y_at_x_division < y_division) || (next_y < y && y_at_x_division > y_division))
+      {
+        output.push_back(vect2Di(next_pos.x, pos.y));
+      }
+      else
+      {
+        output.push_back(vect2Di(pos.x, next_pos.y));
+      }
+    }
+    output.push_back(next_pos);
+    x = next_x;
+    y = next_y;
+    pos = next_pos;
+  }
+  return output;
+}
+
+// Every line from the origin to a square within radius, against doubleOrthogonalBresneham.  Returns the number that differ.
+int verifyOrthogonalBresneham(int radius)
+{
+  int failures = 0;
+  std::vector<vect2Di> squares;
+  for (int x = -radius; x <= radius; x++)
+  {
+    for (int y = -radius; y <= radius; y++)
+    {
+      vect2Di goal(x, y);
+      std::vector<vect2Di> expected = doubleOrthogonalBresneham(goal);
+      squares.assign(orthogonalBresnehamLength(goal), vect2Di(0, 0));
+      orthogonalBresneham(goal, squares.data());
+      if (squares != expected)
+      {
+        if (failures < 10)
+        {
+          fprintf(stderr, "orthogonalBresneham(%d, %d) differs from the reference\n", x, y);
+        }
+        failures++;
+      }
+    }
+  }
+  printf("orthogonalBresneham: %d of %d lines out to radius %d differ\n", failures, (2 * radius + 1) * (2 * radius + 1), radius);
+  return failures;
+}
+
+// Every stream of the laser for every turn out past the end of its path table, facing every way across portal seams, cast the way
+// shootLaser did before it had the table: the stream's shape worked out on its own, turned and moved to the player, then cast.
+// Returns the number of streams whose squares differ.
+int verifyLaserPaths(int radius)
+{
+  resetWorld(200);
+  addPortalSeams();
+  sight_radius = radius;
+  int failures = 0;
+  int streams = 0;
+  const vect2Di FACINGS[] = {RIGHT, UP, LEFT, DOWN};
+  for (int t = 0; t < LASER_TABLE_TURNS + 20; t++)
+  {
+    for (vect2Di facing : FACINGS)
+    {
+      Transform rot_to_facing;
+      for (int i = 0; i < facing.ccwRotations(); i++)
+      {
+        rot_to_facing *= CCW;
+      }
+      int first_path;
+      LaserPathTable& paths = laserPathTable(t, first_path);
+      Line* lines[LASER_STREAMS];
+      curveCastBatch(lines, LASER_STREAMS, player_board, player_pos, rot_to_facing,
+                     paths.squares.data(), &paths.starts[first_path], &paths.shared[first_path]);
+      for (int p = 0; p < LASER_STREAMS; p++)
+      {
+        std::vector<vect2Di> naive_squares;
+        naiveLaserSquares(naive_squares, t, static_cast<double>(p)/static_cast<double>(LASER_STREAMS+25));
+        for (vect2Di& square : naive_squares)
+        {
+          square = square * rot_to_facing + player_pos;
+        }
+        Line& expected = curveCast(player_board, naive_squares);
+        bool same = expected.size() == lines[p]->size();
+        for (int i = 0; same && i < expected.size(); i++)
+        {
+          same = expected[i].board == (*lines[p])[i].board && expected[i].board_pos == (*lines[p])[i].board_pos;
+        }
+        if (!same)
+        {
+          if (failures < 10)
+          {
+            fprintf(stderr, "laser stream %d of turn %d facing (%d, %d) differs from the reference\n", p, t, facing.x, facing.y);
+          }
+          failures++;
+        }
+        streams++;
+      }
+      line_arena.reset();
+    }
+  }
+  printf("laser: %d of %d streams out to radius %d differ\n", failures, streams, radius);
+  sight_radius = SIGHT_RADIUS;
+  return failures;
+}
+
+// Every taken cell of one system this turn has to have been updated by exactly one tile, which owns it, and no two tiles of a board
+// may share a word of the planes.  The system's buffers still hold the tiles it used.  Returns the number of cells or tiles that break that.
+int checkTileClaims(std::vector<Tile>& tiles, ActiveSet Board::* active_set)
+{
+  int problems = 0;
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    std::vector<int>& taken = (*board.*active_set).taken;
+    std::vector<int> claims(taken.size(), 0);
+    int last_end = 0;
+    for (Tile& tile : tiles)
+    {
+      if (tile.board != board->id)
+      {
+        continue;
+      }
+      if (tile.begin % 64 != 0 || tile.begin < last_end)
+      {
+        problems++;
+      }
+      last_end = tile.end;
+      for (int k = tile.first; k < tile.last; k++)
+      {
+        claims[k]++;
+        if (!tile.owns(board->id, taken[k]))
+        {
+          problems++;
+        }
+      }
+    }
+    for (int k = 0; k < static_cast<int>(taken.size()); k++)
+    {
+      // each cell is taken once, and claimed once
+      if (claims[k] != 1 || (k > 0 && taken[k] <= taken[k - 1]))
+      {
+        problems++;
+      }
+    }
+  }
+  return problems;
+}
+
+long long totalWater()
+{
+  long long total = 0;
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    for (int i = 0; i < board->numCells(); i++)
+    {
+      total += board->getWater(i);
+    }
+  }
+  return total;
+}
+
+long long totalSteam()
+{
+  long long total = 0;
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    for (int i = 0; i < board->numCells(); i++)
+    {
+      total += board->getSteam(i);
+    }
+  }
+  return total;
+}
+
+// How many cells of every board test is true for
+long long countCells(std::function<bool(Board&, int)> test)
+{
+  long long count = 0;
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    for (int i = 0; i < board->numCells(); i++)
+    {
+      count += test(*board, i);
+    }
+  }
+  return count;
+}
+
+// Fire, plants, water, and steam across portal seams, in tiles of several sizes on one and several threads.
+// Tiles can come out differently from whole boards, but they still have to follow the rules the serial update did:
+// every active cell is updated once, water and steam are only ever moved, boiled, or faded away, never made or lost in a flow,
+// and a tile size comes out the same whatever the number of threads.  Returns the number of turns that broke one of those.
+int verifyTiles()
+{
+  const int TURNS = 40;
+  const int TILE_SIZES[] = {0, 64, 1000, 4096};
+  const int THREADS[] = {1, 4};
+  int saved_tile_cells = tile_cells;
+  int saved_threads = worker_threads;
+  int failures = 0;
+  int runs = 0;
+  for (int size : TILE_SIZES)
+  {
+    uint64_t first_checksum = 0;
+    for (int threads : THREADS)
+    {
+      tile_cells = size;
+      worker_threads = threads;
+      resetWorld(200);
+      addPortalSeams();
+      scatterWalls(0.05);
+      scatter(player_board, 0.3, 7, [](vect2Di pos, std::mt19937& rng)
+      {
+        if (player_board->getWall(pos))
+        {
+          return;
+        }
+        switch (rng() % 4)
+        {
+          case 0:
+            player_board->setPlant(pos, PLANT_MAX_HEALTH);
+            player_board->setFire(pos, rng() % 5 == 0);
+            break;
+          case 1:
+            player_board->setWater(pos, 1 + rng() % 10);
+            break;
+          case 2:
+            player_board->setSteam(pos, 1 + rng() % 100);
+            break;
+          default:
+            player_board->setWater(pos, 1 + rng() % 3);
+            player_board->setFire(pos, true);
+        }
+      });
+      for (int turn = 0; turn < TURNS; turn++)
+      {
+        bool ok = true;
+        updateFire();
+        ok = ok && checkTileClaims(fire_buffers.tiles, &Board::active_fire) == 0;
+        updatePlants();
+        ok = ok && checkTileClaims(plant_buffers.tiles, &Board::active_plants) == 0;
+
+        // every wet square on fire boils one water into STEAM_PER_WATER steam, and the rest of the water just moves
+        long long water = totalWater();
+        long long steam = totalSteam();
+        long long boiling = countCells([](Board& board, int i) { return board.getWater(i) > 0 && board.getFire(i); });
+        updateWater();
+        ok = ok && checkTileClaims(water_buffers.tiles, &Board::active_water) == 0;
+        ok = ok && totalWater() == water - boiling && totalSteam() == steam + boiling * STEAM_PER_WATER;
+
+        // squares with just one steam lose it, and the rest of the steam just moves
+        steam = totalSteam();
+        long long fading = countCells([](Board& board, int i) { return board.getSteam(i) == 1; });
+        updateSteam();
+        ok = ok && checkTileClaims(steam_buffers.tiles, &Board::active_steam) == 0;
+        ok = ok && totalSteam() == steam - fading;
+
+        world_tick++;
+        if (!ok)
+        {
+          if (failures < 10)
+          {
+            fprintf(stderr, "turn %d with %d cell tiles on %d threads broke the serial rules\n", turn, size, threads);
+          }
+          failures++;
+        }
+      }
+      uint64_t checksum = worldChecksum();
+      if (threads == THREADS[0])
+      {
+        first_checksum = checksum;
+      }
+      else if (checksum != first_checksum)
+      {
+        fprintf(stderr, "%d cell tiles on %d threads came out differently than on %d\n", size, threads, THREADS[0]);
+        failures++;
+      }
+      runs++;
+    }
+  }
+  printf("tiles: %d of %d turns differ from the serial rules, over tile sizes 0 to 4096 and 1 to 4 threads\n", failures, runs * TURNS);
+  tile_cells = saved_tile_cells;
+  worker_threads = saved_threads;
+  return failures;
+}
+
+std::vector<std::string> splitList(const char* text)
+{
+  std::vector<std::string> items;
+  std::string item;
+  for (const char* c = text; ; c++)
+  {
+    if (*c == ',' || *c == '\0')
+    {
+      if (!item.empty())
+      {
+        items.push_back(item);
+      }
+      item.clear();
+      if (*c == '\0')
+      {
+        break;
+      }
+    }
+    else
+    {
+      item += *c;
+    }
+  }
+  return items;
+}
+
+int main(int argc, char** argv)
+{
+  std::string filter;
+  std::vector<int> sizes = {100, 400};
+  std::vector<int> radii = {15, 30, 60};
+  std::vector<double> densities = {0.05, 0.25};
+  int verify_radius = -1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--filter") == 0 && i+1 < argc)
+    {
+      filter = argv[++i];
+    }
+    else if (strcmp(argv[i], "--sizes") == 0 && i+1 < argc)
+    {
+      sizes.clear();
+      for (std::string item : splitList(argv[++i]))
+        sizes.push_back(atoi(item.c_str()));
+    }
+    else if (strcmp(argv[i], "--radii") == 0 && i+1 < argc)
+    {
+      radii.clear();
+      for (std::string item : splitList(argv[++i]))
+        radii.push_back(atoi(item.c_str()));
+    }
+    else if (strcmp(argv[i], "--densities") == 0 && i+1 < argc)
+    {
+      densities.clear();
+      for (std::string item : splitList(argv[++i]))
+        densities.push_back(atof(item.c_str()));
+    }
+    else if (strcmp(argv[i], "--tile") == 0 && i+1 < argc)
+    {
+      tile_cells = std::max(0, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc)
+    {
+      worker_threads = std::max(1, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--min-time") == 0 && i+1 < argc)
+    {
+      min_seconds = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--verify") == 0 && i+1 < argc)
+    {
+      verify_radius = atoi(argv[++i]);
+    }
+    else
+    {
+      fprintf(stderr, "usage: labyrinth_bench [--filter NAME] [--sizes 100,400] [--radii 15,30,60] [--densities 0.05,0.25] [--min-time SECONDS] [--threads N] [--tile CELLS]\n");
+      fprintf(stderr, "       labyrinth_bench --verify RADIUS\n");
+      return 1;
+    }
+  }
+
+  if (verify_radius >= 0)
+  {
+    int failures = verifyOrthogonalBresneham(verify_radius);
+    failures += verifyLaserPaths(verify_radius);
+    failures += verifyTiles();
+    return failures == 0 ? 0 : 1;
+  }
+
+  auto wanted = [&](const char* name)
+  {
+    return filter.empty() || strstr(name, filter.c_str()) != nullptr;
+  };
+
+  printHeader();
+
+  // The casting benchmarks, which care about how far things are cast
+  for (int size : sizes)
+  {
+    for (int radius : radii)
+    {
+      // every cast has to fit on the board
+      if (2 * radius + 2 >= size)
+      {
+        continue;
+      }
+      for (double density : densities)
+      {
+        std::vector<vect2Di> ends = ringEndpoints(radius);
+        auto walls = [&]() { resetWorld(size); scatterWalls(density); };
+        auto walls_and_portals = [&]() { resetWorld(size); scatterWalls(density); addPortalSeams(); };
+        auto nothing = []() {};
+
+        if (wanted("orthogonalBresneham"))
+        {
+          std::vector<vect2Di> squares(orthogonalBresnehamLength(vect2Di(radius, radius)));
+          printResult("orthogonalBresneham", size, radius, density, measure(nothing, [&]()
+          {
+            for (vect2Di end : ends)
+            {
+              orthogonalBresneham(end, squares.data());
+            }
+          }, ends.size()));
+        }
+        if (wanted("doubleOrthogonalBresneham"))
+        {
+          printResult("doubleOrthogonalBresneham", size, radius, density, measure(nothing, [&]()
+          {
+            for (vect2Di end : ends)
+            {
+              doubleOrthogonalBresneham(end);
+            }
+          }, ends.size()));
+        }
+
+        for (int with_portals = 0; with_portals < 2; with_portals++)
+        {
+          const char* line_name = with_portals ? "lineCast+portals" : "lineCast";
+          const char* curve_name = with_portals ? "curveCast+portals" : "curveCast";
+          std::function<void()> setup = with_portals ? std::function<void()>(walls_and_portals) : std::function<void()>(walls);
+          if (wanted(line_name))
+          {
+            setup();
+            printResult(line_name, size, radius, density, measure(nothing, [&]()
+            {
+              for (vect2Di end : ends)
+              {
+                lineCast(player_board, player_pos, end, true);
+                // the world would do this every turn
+                line_arena.reset();
+              }
+            }, ends.size()));
+          }
+          if (wanted(curve_name))
+          {
+            setup();
+            // the naive squares are made ahead of time, so this is just the portal-following part
+            std::vector<std::vector<vect2Di>> naive_lines;
+            for (vect2Di end : ends)
+            {
+              naive_lines.push_back(orthogonalBresneham(player_pos, player_pos + end));
+            }
+            printResult(curve_name, size, radius, density, measure(nothing, [&]()
+            {
+              for (const std::vector<vect2Di>& naive_line : naive_lines)
+              {
+                curveCast(player_board, naive_line, true);
+                line_arena.reset();
+              }
+            }, ends.size()));
+          }
+        }
+
+        for (int mode = SIGHT_RAYS; mode <= SIGHT_SHADOWCAST; mode++)
+        {
+          // from scratch, with nothing changed, and with one wall in sight toggled
+          const char* names[2][3] = {{"updateSightLines", "updateSightLines+idle", "updateSightLines+wall"},
+                                     {"updateSightLines+shadow", "updateSightLines+shadow+idle", "updateSightLines+shadow+wall"}};
+          vect2Di toggled;
+          std::function<void()> setups[3] = {
+            []() { invalidateSight(); },
+            []() {},
+            [&]() { player_board->setWall(toggled, !player_board->getWall(toggled)); }};
+          for (int kind = 0; kind < 3; kind++)
+          {
+            if (wanted(names[mode][kind]))
+            {
+              walls_and_portals();
+              sight_radius = radius;
+              sight_mode = static_cast<SightMode>(mode);
+              // somewhere partway along the first sight line, so it is surely in sight
+              updateSightLines();
+              Line& first_line = player_sight_lines[0];
+              toggled = first_line[first_line.size() / 2].board_pos;
+              printResult(names[mode][kind], size, radius, density, measure(setups[kind], []() { updateSightLines(); }));
+              sight_radius = SIGHT_RADIUS;
+              sight_mode = SIGHT_RAYS;
+            }
+          }
+        }
+
+        if (wanted("shootLaser"))
+        {
+          walls();
+          sight_radius = radius;
+          // well into the laser's growth
+          consecutive_laser_rounds = 50;
+          // the laser sets fires, so start from a clean board each time
+          printResult("shootLaser", size, radius, density, measure([&]() { walls(); consecutive_laser_rounds = 50; }, []() { shootLaser(); }));
+          sight_radius = SIGHT_RADIUS;
+        }
+      }
+    }
+  }
+
+  // The simulation benchmarks, which care about how much of the board is busy
+  for (int size : sizes)
+  {
+    for (double density : densities)
+    {
+      if (wanted("updateFire"))
+      {
+        auto setup = [&]()
+        {
+          resetWorld(size);
+          scatter(player_board, density, 2, [](vect2Di pos, std::mt19937& rng)
+          {
+            player_board->setPlant(pos, PLANT_MAX_HEALTH);
+            if (rng() % 10 == 0)
+            {
+              player_board->setFire(pos, true);
+            }
+          });
+        };
+        printResult("updateFire", size, 0, density, measure(setup, []() { updateFire(); }));
+      }
+      if (wanted("updatePlants"))
+      {
+        auto setup = [&]()
+        {
+          resetWorld(size);
+          scatter(player_board, density, 3, [](vect2Di pos, std::mt19937&) { player_board->setPlant(pos, PLANT_MAX_HEALTH); });
+        };
+        printResult("updatePlants", size, 0, density, measure(setup, []() { updatePlants(); }));
+      }
+      if (wanted("updateWater"))
+      {
+        auto setup = [&]()
+        {
+          resetWorld(size);
+          scatter(player_board, density, 4, [](vect2Di pos, std::mt19937& rng) { player_board->setWater(pos, 1 + rng() % 10); });
+          // one turn to get the flow buffers and active lists up to size, so the timed turn is a steady state one
+          updateWater();
+        };
+        printResult("updateWater", size, 0, density, measure(setup, []() { updateWater(); }));
+      }
+      if (wanted("updateSteam"))
+      {
+        auto setup = [&]()
+        {
+          resetWorld(size);
+          scatter(player_board, density, 5, [](vect2Di pos, std::mt19937& rng) { player_board->setSteam(pos, 1 + rng() % 200); });
+          // one turn to get the flow buffers and active lists up to size, so the timed turn is a steady state one
+          updateSteam();
+        };
+        printResult("updateSteam", size, 0, density, measure(setup, []() { updateSteam(); }));
+      }
+      if (wanted("updateEntities"))
+      {
+        auto setup = [&]()
+        {
+          resetWorld(size);
+          // motes and arrows going every which way, so some arrows hit things and die
+          scatter(player_board, density, 6, [](vect2Di pos, std::mt19937& rng)
+          {
+            if (rng() % 2 == 0)
+            {
+              createMote(player_board, pos);
+            }
+            else
+            {
+              createArrow(player_board, pos, ORTHOGONALS[rng() % 4]);
+            }
+          });
+        };
+        if (wanted("updateEntities.field"))
+        {
+          printResult("updateEntities.field", size, 0, density, measure(setup, []() { updateEntities(); }));
+        }
+        if (wanted("updateEntities.sight"))
+        {
+          pursuit_mode = PURSUIT_SIGHT;
+          printResult("updateEntities.sight", size, 0, density, measure(setup, []() { updateEntities(); }));
+          pursuit_mode = PURSUIT_FIELD;
+        }
+      }
+      // Finding the way to the player again after they take a step, around walls and through portal seams
+      if (wanted("updatePursuitField"))
+      {
+        resetWorld(size);
+        scatterWalls(density);
+        addPortalSeams();
+        vect2Di start = player_pos;
+        player_board->setWall(start + RIGHT, false);
+        auto setup = [&]() { player_pos = player_pos == start ? start + RIGHT : start; };
+        printResult("updatePursuitField", size, 0, density, measure(setup, []() { updatePursuitField(); }));
+      }
+      // The water test over a whole board, a word at a time, with each level of scan kernels this CPU has
+      if (wanted("scan.waterActive"))
+      {
+        resetWorld(size);
+        scatter(player_board, density, 4, [](vect2Di pos, std::mt19937& rng) { player_board->setWater(pos, rng() % 3); });
+        scatter(player_board, density, 2, [](vect2Di pos, std::mt19937&) { player_board->setFire(pos, true); });
+        ScanKernels best = scan_kernels;
+        for (int level = SCAN_SCALAR; level <= best.level; level++)
+        {
+          scan_kernels = scanKernels(static_cast<ScanLevel>(level));
+          std::string name = std::string("scan.waterActive.") + SCAN_LEVEL_NAMES[level];
+          volatile int found = 0;
+          printResult(name.c_str(), size, 0, density, measure([]() {}, [&]()
+          {
+            int count = 0;
+            for (int w = 0; w < static_cast<int>(player_board->fire.words.size()); w++)
+            {
+              count += __builtin_popcountll(player_board->waterActiveWord(w));
+            }
+            found = count;
+          }));
+        }
+        scan_kernels = best;
+      }
+    }
+  }
+
+  // Making an empty board, which only pays for its flag planes and chunk tables (see ChunkedPlane)
+  if (wanted("addBoard"))
+  {
+    for (int size : sizes)
+    {
+      printResult("addBoard", size, 0, 0, measure([]() { resetWorld(8); }, [&]() { addBoard(size); }));
+    }
+  }
+
+  // Walking around, for the default memory map and a much bigger one
+  if (wanted("memoryMap.shift"))
+  {
+    for (int size : {MEMORY_MAP_SIZE, 1001})
+    {
+      memory_map.resize(size);
+      printResult("memoryMap.shift", size, 0, 0, measure([]() {}, []()
+      {
+        for (vect2Di step : ORTHOGONALS)
+        {
+          memory_map.shift(step);
+        }
+      }, 4));
+    }
+    memory_map.resize(MEMORY_MAP_SIZE);
+  }
+  return 0;
+}
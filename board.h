@@ -4,108 +4,757 @@
 #include "portal.h"
 #include "line.h"
 #include "entity.h"
+#include "rng.h"
+#include "scan.h"
 #include <utility>
 #include <memory>
 #include <list>
 #include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cassert>
+#include <ctime>
 
 const std::vector<const wchar_t*> GRASS_GLYPHS = {L" ", L" ", L" ", L".", L"'", L",", L"`"};
 const std::vector<int> GRASS_COLORS = {COLOR_YELLOW, COLOR_YELLOW, COLOR_GREEN};
 
+const int MAX_WATER = UINT16_MAX;
+const int MAX_STEAM = UINT16_MAX;
+// In toward_player, for squares with no step closer to the player: the player's own, and the blocked ones
+const uint8_t NO_PURSUIT = 0xff;
+
+// The stream random() draws from, for things that aren't part of a turn (like making boards).
+// It is seeded from the clock unless someone reseeds it for a repeatable world.
+Rng& randomStream()
+{
+  static Rng rng(time(NULL));
+  return rng;
+}
+
 int random(int min, int max) //range : [min, max)
 {
-   static bool first = true;
-   if (first) 
-   {  
-      srand( time(NULL) ); //seeding for the first time only!
-      first = false;
-   }
-   if (max == min)
-   {
-     return min;
-   }
-   return min + rand() % (( max ) - min);
+  return randomStream().range(min, max);
 }
 
-// The board is a 2d array of squares.  Each square can have a portal and/or a block.  Entities are tracked separately for the time being.
-struct Square
+// One flag per cell, packed 64 to a word
+struct BitPlane
 {
-  bool wall = false;
-  bool fire = false;
-  int water = 0; // Water depth
-  int plant = 0; // plant health
-  int steam = 0; // steam pressure
-  const wchar_t* grass_glyph;
-  int grass_color;
-  // These are portals you go through if you are leaving this square.
-  std::shared_ptr<Portal> right_portal;
-  std::shared_ptr<Portal> up_portal;
-  std::shared_ptr<Portal> left_portal;
-  std::shared_ptr<Portal> down_portal;
-  std::weak_ptr<Entity> entity;
+  std::vector<uint64_t> words;
+
+  void resize(int num_bits)
+  {
+    words.assign((num_bits + 63) / 64, 0);
+  }
+
+  bool get(int i) const
+  {
+    return (words[i >> 6] >> (i & 63)) & 1;
+  }
+
+  void set(int i, bool value)
+  {
+    if (value)
+      words[i >> 6] |= uint64_t(1) << (i & 63);
+    else
+      words[i >> 6] &= ~(uint64_t(1) << (i & 63));
+  }
+
+  size_t bytes() const
+  {
+    return words.size() * sizeof(uint64_t);
+  }
 };
 
-struct Board
+// Four flags per cell, one for each of ORTHOGONALS, packed 16 cells to a word so a cell's flags share one
+struct DirectionPlane
 {
-  const int board_size;
-  std::vector<std::vector<Square>> board;
-  std::vector<std::shared_ptr<Entity>> entities;
+  std::vector<uint64_t> words;
+
+  void resize(int num_cells)
+  {
+    words.assign((num_cells + 15) / 16, 0);
+  }
+
+  bool get(int i, int dir) const
+  {
+    return (words[i >> 4] >> ((i & 15) * 4 + dir)) & 1;
+  }
 
-  Board(int board_size)
-    : board(board_size, std::vector<Square>(board_size))
-      , board_size(board_size)
+  void set(int i, int dir)
   {
-    // pick random grass glyphs and colors for every tile
-    for (int x=0; x < board_size; x++)
+    words[i >> 4] |= uint64_t(1) << ((i & 15) * 4 + dir);
+  }
+
+  size_t bytes() const
+  {
+    return words.size() * sizeof(uint64_t);
+  }
+};
+
+// One value per cell, for a plane that is mostly the default (no water, no plant, nothing here).
+// The cells are kept in chunks of 64, the same cells as a word of a BitPlane, and a chunk only gets storage of its own once one of its cells is
+// set to something else, so a big stretch of open floor costs a pointer per 64 cells.  Chunks are kept once they have storage.
+// The rest all point at one shared chunk of the default, so reading a cell never has to check.
+// Threads changing different words of the planes (see unlistChanges) never share a chunk, so they can add chunks without getting in each other's way.
+template <typename T>
+struct ChunkedPlane
+{
+  std::vector<T*> chunks;
+  // What the cells of a chunk with no storage are
+  std::unique_ptr<T[]> defaults;
+
+  ChunkedPlane() = default;
+  ChunkedPlane(const ChunkedPlane&) = delete;
+  ChunkedPlane& operator= (const ChunkedPlane&) = delete;
+
+  ~ChunkedPlane()
+  {
+    clear();
+  }
+
+  void resize(int num_cells, const T& default_value)
+  {
+    clear();
+    defaults.reset(new T[64]);
+    std::fill(defaults.get(), defaults.get() + 64, default_value);
+    chunks.assign((num_cells + 63) / 64, defaults.get());
+  }
+
+  // Has it been resized to have any cells yet?
+  bool empty() const
+  {
+    return chunks.empty();
+  }
+
+  // Drops all the storage, leaving no cells until the next resize
+  void clear()
+  {
+    for (T* chunk : chunks)
+    {
+      if (chunk != defaults.get())
+      {
+        delete[] chunk;
+      }
+    }
+    chunks.clear();
+  }
+
+  const T& get(int i) const
+  {
+    return chunks[i >> 6][i & 63];
+  }
+
+  // The cell to write to, giving its chunk storage if it doesn't have any
+  T& at(int i)
+  {
+    T*& chunk = chunks[i >> 6];
+    if (chunk == defaults.get())
     {
-      for (int y=0; y < board_size; y++)
+      allocate(chunk);
+    }
+    return chunk[i & 63];
+  }
+
+  // Setting a cell of a chunk with no storage to the default leaves it that way
+  void set(int i, const T& value)
+  {
+    T*& chunk = chunks[i >> 6];
+    if (chunk == defaults.get())
+    {
+      if (value == defaults[0])
       {
-        getSquare(vect2Di(x, y))->grass_glyph = GRASS_GLYPHS[random(0, GRASS_GLYPHS.size())];
-        getSquare(vect2Di(x, y))->grass_color = GRASS_COLORS[random(0, GRASS_COLORS.size())];
+        return;
       }
+      allocate(chunk);
     }
+    chunk[i & 63] = value;
+  }
 
-    rectToWall(0, 0, board_size-1, board_size-1);
+  // The 64 cells of word w of a BitPlane, or nullptr if they are all the default
+  const T* chunk(int w) const
+  {
+    return chunks[w] != defaults.get() ? chunks[w] : nullptr;
+  }
+
+  // The chunk table, and the chunks that have storage
+  size_t bytes() const
+  {
+    size_t total = chunks.size() * sizeof(T*);
+    for (T* chunk : chunks)
+    {
+      if (chunk != defaults.get())
+      {
+        total += 64 * sizeof(T);
+      }
+    }
+    return total;
+  }
+
+private:
+  void allocate(T*& chunk)
+  {
+    chunk = new T[64];
+    std::copy(defaults.get(), defaults.get() + 64, chunk);
+  }
+};
+
+// The cells one system of the simulation needs to look at next turn, as a membership plane and a list of the members.
+// Cells are added as they gain whatever the system cares about, and the system drops the ones that lost it as it goes.
+struct ActiveSet
+{
+  BitPlane member;
+  std::vector<int> cells;
+  // The cells being updated this turn, kept around so its storage is reused
+  std::vector<int> taken;
+  // False while cells are being added from more than one thread, or the set is too busy for a list to be worth keeping,
+  // when only the plane is kept up to date
+  bool listed = true;
+
+  void resize(int num_cells)
+  {
+    member.resize(num_cells);
+    cells.clear();
+  }
+
+  void add(int i)
+  {
+    if (!member.get(i))
+    {
+      member.set(i, true);
+      if (listed)
+      {
+        cells.push_back(i);
+      }
+    }
+  }
+
+  // Stop keeping the list, so threads adding cells from different words of the plane don't get in each other's way.
+  // take() reads the plane instead until then.
+  void unlist()
+  {
+    listed = false;
+    cells.clear();
+  }
+
+  // Empties the set and returns what was in it in cell order, the order a scan of the whole board would find them.
+  // Anything still active after the update has to be added back.
+  // taken and cells each keep their own storage, so once they have grown to what the board needs, taking the set allocates nothing.
+  std::vector<int>& take()
+  {
+    if (!listed || cells.size() * 16 > member.words.size())
+    {
+      // a busy set is quicker to read back out of the plane in order than to sort
+      int count = 0;
+      for (uint64_t word : member.words)
+      {
+        count += __builtin_popcountll(word);
+      }
+      taken.clear();
+      taken.reserve(count);
+      for (int w = 0; w < static_cast<int>(member.words.size()); w++)
+      {
+        uint64_t word = member.words[w];
+        while (word != 0)
+        {
+          taken.push_back(w * 64 + __builtin_ctzll(word));
+          word &= word - 1;
+        }
+        member.words[w] = 0;
+      }
+    }
+    else
+    {
+      taken.assign(cells.begin(), cells.end());
+      for (int i : taken)
+      {
+        member.set(i, false);
+      }
+      std::sort(taken.begin(), taken.end());
+    }
+    cells.clear();
+    // A set this busy will be read out of the plane next turn too, so there is no point listing what gets added to it
+    listed = taken.size() * 16 <= member.words.size();
+    return taken;
+  }
+};
+
+// Where leaving a cell by one of ORTHOGONALS ends up, through the portal on that edge if there is one (see Board::steps)
+struct CellStep
+{
+  // The cell it lands on, or -1 if that is off the board it lands on
+  int32_t cell;
+  // The index of the board it lands on (see MAX_BOARDS)
+  uint16_t board;
+  // The portal's Transform::index and color
+  uint8_t transform;
+  uint8_t color;
+};
+
+// The steps out of one cell, by direction
+struct CellSteps
+{
+  CellStep dirs[4];
+};
+
+// Boards are numbered in a CellStep's 16 bits
+const int MAX_BOARDS = 65536;
+// And a LineSquare keeps a position on a board in 16 bits
+const int MAX_BOARD_SIDE = 32767;
+
+// The board is a 2d grid of squares, stored as one plane per property so the simulation loops only pull in the fields they read.
+// Each board has its own width and height.  Cells are indexed column by column (see cellIndex), matching the x-then-y order of the update loops.
+// The flags are BitPlanes, and everything wider is a ChunkedPlane, which only has storage where the board has something going on.
+// Portals are rare, so they live in a side table rather than in every cell.
+// Portals are interned per board, and each edge that has one just stores a small index into that list.
+// Where every portal leads is worked out ahead in steps, so the inner loops never look at the side table.
+struct Board
+{
+  const int width;
+  const int height;
+  // This board's handle, set by addBoard
+  BoardId id;
+
+  BitPlane wall;
+  BitPlane fire;
+  ChunkedPlane<uint16_t> water; // Water depth
+  ChunkedPlane<uint8_t> plant; // plant health
+  ChunkedPlane<uint16_t> steam; // steam pressure
+  // Grass isn't stored, it is picked for each square from this (see grassBits)
+  uint64_t grass_seed;
+
+  // These are portals you go through if you are leaving a square.
+  // Bit d of portal_dirs is set if leaving the square by ORTHOGONALS[d] goes through a portal,
+  // in which case portal_edges maps cellIndex*4 + d to the portal's index in portals.
+  std::vector<Portal> portals;
+  ChunkedPlane<uint8_t> portal_dirs;
+  // (64 bits, since a board MAX_BOARD_SIDE on a side has more than INT_MAX/4 cells)
+  std::unordered_map<int64_t, uint16_t> portal_edges;
+  // Where leaving cell i by ORTHOGONALS[d] through a portal ends up is steps.get(i).dirs[d], kept up to date by setPortal.
+  // Every other step in it goes off the board (cell -1).
+  ChunkedPlane<CellSteps> steps;
+  // Set for the steps that don't just go to the next cell over on this board, through a portal or off the edge (see stepCell)
+  DirectionPlane unusual_steps;
+  // What to add to a cell index to get the next cell over by each of ORTHOGONALS
+  int cell_deltas[4];
+  // The id of the entity on each square, or an invalid id for none
+  ChunkedPlane<EntityId> occupants;
+  // The entities on this board.  Their ids come from entity_store, which is also what adds, removes, and moves them.
+  EntityArrays entities;
+
+  // The cells the fire, water, steam, and plant updates need to look at.  The setters keep these up to date.
+  ActiveSet active_fire;
+  ActiveSet active_water;
+  ActiveSet active_steam;
+  ActiveSet active_plants;
+
+  // Set for squares the player's cached sight reached (see SightCache).
+  // Sight blocking or portal changes on those squares are listed in sight_changes, once each, with sight_dirty set.
+  BitPlane in_sight;
+  BitPlane sight_dirty;
+  std::vector<int> sight_changes;
+  // False when sight_changes hasn't been kept up to date, see unlistChanges
+  bool sight_changes_listed = true;
+  // Where the player sees each in_sight square, relative to the player.
+  // Only sized while the board is in sight, and only has storage for the chunks that are, like toward_player.
+  ChunkedPlane<vect2Di> seen_at;
+
+  // Set for squares the player's pursuit field looked at (see PursuitField), and in pursuit_dirty too once their walls, plants, or portals change.
+  BitPlane in_pursuit;
+  BitPlane pursuit_dirty;
+  // For each in_pursuit square, the index into ORTHOGONALS of a step that gets closer to the player, or NO_PURSUIT.
+  // Only sized while the field reaches the board, and only has storage for the chunks it reaches.
+  ChunkedPlane<uint8_t> toward_player;
+
+  Board(int width, int height)
+    : width(width), height(height)
+  {
+    int num_cells = width * height;
+    wall.resize(num_cells);
+    fire.resize(num_cells);
+    water.resize(num_cells, 0);
+    plant.resize(num_cells, 0);
+    steam.resize(num_cells, 0);
+    grass_seed = randomStream().next();
+    portal_dirs.resize(num_cells, 0);
+    CellSteps off_board;
+    for (CellStep& step : off_board.dirs)
+    {
+      step = CellStep{-1, 0, IDENTITY.index, COLOR_WHITE};
+    }
+    steps.resize(num_cells, off_board);
+    unusual_steps.resize(num_cells);
+    cell_deltas[0] = height;
+    cell_deltas[1] = 1;
+    cell_deltas[2] = -height;
+    cell_deltas[3] = -1;
+    occupants.resize(num_cells, EntityId());
+    active_fire.resize(num_cells);
+    active_water.resize(num_cells);
+    active_steam.resize(num_cells);
+    active_plants.resize(num_cells);
+    in_sight.resize(num_cells);
+    sight_dirty.resize(num_cells);
+    in_pursuit.resize(num_cells);
+    pursuit_dirty.resize(num_cells);
+
+    // the steps off the edges
+    for (int x = 0; x < width; x++)
+    {
+      unusual_steps.set(cellIndex(vect2Di(x, 0)), directionIndex(DOWN));
+      unusual_steps.set(cellIndex(vect2Di(x, height-1)), directionIndex(UP));
+    }
+    for (int y = 0; y < height; y++)
+    {
+      unusual_steps.set(cellIndex(vect2Di(0, y)), directionIndex(LEFT));
+      unusual_steps.set(cellIndex(vect2Di(width-1, y)), directionIndex(RIGHT));
+    }
+
+    rectToWall(0, 0, width-1, height-1);
+  }
+
+  // Roughly how much memory the board's planes take up
+  size_t storageBytes()
+  {
+    size_t total = wall.bytes() + fire.bytes() + in_sight.bytes() + sight_dirty.bytes() + in_pursuit.bytes() + pursuit_dirty.bytes();
+    total += active_fire.member.bytes() + active_water.member.bytes() + active_steam.member.bytes() + active_plants.member.bytes();
+    total += unusual_steps.bytes() + water.bytes() + plant.bytes() + steam.bytes() + portal_dirs.bytes() + steps.bytes();
+    total += occupants.bytes() + seen_at.bytes() + toward_player.bytes();
+    return total;
   }
 
   bool onBoard(vect2Di p)
   {
-    return (p.x>=0 && p.y>=0 && p.x<board_size && p.y<board_size);
+    return (p.x>=0 && p.y>=0 && p.x<width && p.y<height);
+  }
+
+  int numCells()
+  {
+    return width * height;
+  }
+
+  // assumes the position is on the board
+  int cellIndex(vect2Di pos)
+  {
+    return pos.x * height + pos.y;
+  }
+
+  vect2Di cellPos(int i)
+  {
+    return vect2Di(i / height, i % height);
+  }
+
+  // Walls, plants, and steam block sight, and portals bend it.  Call this when one of those changes on a square.
+  void noteSightChange(int i)
+  {
+    if (in_sight.get(i) && !sight_dirty.get(i))
+    {
+      sight_dirty.set(i, true);
+      if (sight_changes_listed)
+      {
+        sight_changes.push_back(i);
+      }
+    }
+  }
+
+  // Walls, plants, and portals change where you can go.  Call this when one of those changes on a square.
+  void notePathChange(int i)
+  {
+    if (in_pursuit.get(i))
+    {
+      pursuit_dirty.set(i, true);
+    }
+  }
+
+  // For while several threads are changing different parts of the board (in whole words of the planes).
+  // The active sets and sight changes are only marked in their planes, and listed again when they are next needed.
+  void unlistChanges()
+  {
+    active_fire.unlist();
+    active_water.unlist();
+    active_steam.unlist();
+    active_plants.unlist();
+    sight_changes_listed = false;
+    sight_changes.clear();
+  }
+
+  std::vector<int>& sightChanges()
+  {
+    if (!sight_changes_listed)
+    {
+      for (int w = 0; w < static_cast<int>(sight_dirty.words.size()); w++)
+      {
+        uint64_t word = sight_dirty.words[w];
+        while (word != 0)
+        {
+          sight_changes.push_back(w * 64 + __builtin_ctzll(word));
+          word &= word - 1;
+        }
+      }
+      sight_changes_listed = true;
+    }
+    return sight_changes;
+  }
+
+  // Accessors by cell index are for the inner loops; the position overloads assume the position is on the board.
+  bool getWall(int i) { return wall.get(i); }
+  bool getWall(vect2Di pos) { return wall.get(cellIndex(pos)); }
+  void setWall(int i, bool value)
+  {
+    if (wall.get(i) != value)
+    {
+      noteSightChange(i);
+      notePathChange(i);
+    }
+    wall.set(i, value);
+  }
+  void setWall(vect2Di pos, bool value) { setWall(cellIndex(pos), value); }
+
+  bool getFire(int i) { return fire.get(i); }
+  bool getFire(vect2Di pos) { return fire.get(cellIndex(pos)); }
+  void setFire(int i, bool value)
+  {
+    fire.set(i, value);
+    if (fireActive(i))
+      active_fire.add(i);
+    if (waterActive(i))
+      active_water.add(i);
+  }
+  void setFire(vect2Di pos, bool value) { setFire(cellIndex(pos), value); }
+
+  int getWater(int i) { return water.get(i); }
+  int getWater(vect2Di pos) { return water.get(cellIndex(pos)); }
+  void setWater(int i, int value)
+  {
+    water.set(i, std::min(std::max(value, 0), MAX_WATER));
+    if (waterActive(i))
+      active_water.add(i);
+  }
+  void setWater(vect2Di pos, int value) { setWater(cellIndex(pos), value); }
+
+  int getPlant(int i) { return plant.get(i); }
+  int getPlant(vect2Di pos) { return plant.get(cellIndex(pos)); }
+  void setPlant(int i, int value)
+  {
+    if ((plant.get(i) > 0) != (value > 0))
+    {
+      noteSightChange(i);
+      notePathChange(i);
+    }
+    plant.set(i, value);
+    if (plantActive(i))
+      active_plants.add(i);
+  }
+  void setPlant(vect2Di pos, int value) { setPlant(cellIndex(pos), value); }
+
+  int getSteam(int i) { return steam.get(i); }
+  int getSteam(vect2Di pos) { return steam.get(cellIndex(pos)); }
+  void setSteam(int i, int value)
+  {
+    value = std::min(std::max(value, 0), MAX_STEAM);
+    if ((steam.get(i) > 0) != (value > 0))
+      noteSightChange(i);
+    steam.set(i, value);
+    if (steamActive(i))
+      active_steam.add(i);
+  }
+  void setSteam(vect2Di pos, int value) { setSteam(cellIndex(pos), value); }
+
+  // Whether each system has anything to do with a cell next turn
+  bool fireActive(int i) { return getFire(i); }
+  // deep enough to flow, or boiling
+  bool waterActive(int i) { return getWater(i) > 1 || (getWater(i) > 0 && getFire(i)); }
+  bool steamActive(int i) { return getSteam(i) > 0; }
+  // Whether the water and steam are deep enough to flow out of a cell
+  bool waterCanFlow(int i) { return getWater(i) > 1; }
+  bool steamCanFlow(int i) { return getSteam(i) > 1; }
+  bool plantActive(int i) { return getPlant(i) != 0; }
+
+  // Whether the fire and plants can spread from a cell this turn
+  bool fireCanSpread(int i) { return getFire(i) && getPlant(i) > 1; }
+  bool plantCanSpread(int i) { return getPlant(i) != 0 && !getFire(i); }
+
+  // The same tests for the 64 cells of word w of the planes at once, as a mask (see scan.h).
+  // A chunk with no storage is all zeros, which none of them pass.
+  int wordCells(int w) { return std::min(64, numCells() - w * 64); }
+  uint64_t fireActiveWord(int w) { return fire.words[w]; }
+  uint64_t waterActiveWord(int w)
+  {
+    const uint16_t* depths = water.chunk(w);
+    if (depths == nullptr)
+      return 0;
+    return scan_kernels.above16(depths, wordCells(w), 1) | (scan_kernels.above16(depths, wordCells(w), 0) & fire.words[w]);
+  }
+  uint64_t steamActiveWord(int w) { return above16(steam.chunk(w), w, 0); }
+  uint64_t plantActiveWord(int w) { return above8(plant.chunk(w), w, 0); }
+  uint64_t waterCanFlowWord(int w) { return above16(water.chunk(w), w, 1); }
+  uint64_t steamCanFlowWord(int w) { return above16(steam.chunk(w), w, 1); }
+  uint64_t fireCanSpreadWord(int w) { return fire.words[w] & above8(plant.chunk(w), w, 1); }
+  uint64_t plantCanSpreadWord(int w) { return plantActiveWord(w) & ~fire.words[w]; }
+
+  uint64_t above16(const uint16_t* chunk, int w, int threshold)
+  {
+    return chunk != nullptr ? scan_kernels.above16(chunk, wordCells(w), threshold) : 0;
+  }
+  uint64_t above8(const uint8_t* chunk, int w, int threshold)
+  {
+    return chunk != nullptr ? scan_kernels.above8(chunk, wordCells(w), threshold) : 0;
+  }
+
+  // The grass on a square never changes, so rather than storing it, it comes from hashing the square.
+  // The low 32 bits pick the glyph and the high ones the color.
+  uint64_t grassBits(vect2Di pos)
+  {
+    return mixBits(grass_seed ^ static_cast<uint64_t>(cellIndex(pos)));
+  }
+
+  const wchar_t* getGrassGlyph(vect2Di pos)
+  {
+    uint64_t bits = grassBits(pos) & 0xffffffff;
+    return GRASS_GLYPHS[(bits * GRASS_GLYPHS.size()) >> 32];
   }
 
-  Square* getSquare(vect2Di pos)
+  int getGrassColor(vect2Di pos)
   {
-    if (!onBoard(pos))
+    uint64_t bits = grassBits(pos) >> 32;
+    return GRASS_COLORS[(bits * GRASS_COLORS.size()) >> 32];
+  }
+
+  // Where leaving cell i by ORTHOGONALS[dir] ends up, for the unusual steps
+  const CellStep& step(int i, int dir)
+  {
+    return steps.get(i).dirs[dir];
+  }
+
+  // The portal you go through when leaving pos by step, or nullptr
+  Portal* getPortal(vect2Di pos, vect2Di step)
+  {
+    return getPortal(cellIndex(pos), directionIndex(step));
+  }
+
+  // The portal you go through when leaving cell i by ORTHOGONALS[dir], or nullptr
+  Portal* getPortal(int i, int dir)
+  {
+    if (((portal_dirs.get(i) >> dir) & 1) == 0)
     {
       return nullptr;
     }
-    else
+    return &portals[portal_edges.find(int64_t(i) * 4 + dir)->second];
+  }
+
+  // Leaving pos by step now lands on new_pos of new_board
+  void setPortal(vect2Di pos, vect2Di step, BoardId new_board, vect2Di new_pos, Transform transform = IDENTITY, int color = COLOR_WHITE)
+  {
+    Portal portal;
+    portal.offset = new_pos - (pos + step);
+    portal.new_board = new_board;
+    portal.transform = transform;
+    portal.color = color;
+
+    int i = cellIndex(pos);
+    int dir = directionIndex(step);
+    portal_dirs.at(i) |= 1 << dir;
+    portal_edges[int64_t(i) * 4 + dir] = internPortal(portal);
+    CellStep& cell_step = steps.at(i).dirs[dir];
+    cell_step.cell = new_board->onBoard(new_pos) ? new_board->cellIndex(new_pos) : -1;
+    cell_step.board = new_board.index;
+    cell_step.transform = transform.index;
+    cell_step.color = color;
+    unusual_steps.set(i, dir);
+    noteSightChange(i);
+    notePathChange(i);
+  }
+
+  // index of an identical portal already on this board, adding it if there isn't one
+  int internPortal(Portal portal)
+  {
+    for (int id = 0; id < static_cast<int>(portals.size()); id++)
     {
-      Square* ptr = &board[pos.x][pos.y];
-      return ptr;
+      Portal& existing = portals[id];
+      if (existing.new_board == portal.new_board &&
+          existing.offset == portal.offset &&
+          existing.transform == portal.transform &&
+          existing.color == portal.color)
+      {
+        return id;
+      }
     }
+    portals.push_back(portal);
+    return portals.size() - 1;
+  }
+
+  // The entity on pos, or an invalid id
+  EntityId getEntity(vect2Di pos)
+  {
+    return occupants.get(cellIndex(pos));
+  }
+
+  bool hasEntity(vect2Di pos)
+  {
+    return occupants.get(cellIndex(pos)).valid();
+  }
+
+  // An invalid id clears the square
+  void setEntity(vect2Di pos, EntityId entity)
+  {
+    occupants.set(cellIndex(pos), entity);
   }
 
   void rectToWall(int left, int bottom, int right, int top)
   {
     for (int x = left; x < right+1; x++)
     {
-      board[x][bottom].wall = true;
-      board[x][top].wall = true;
+      setWall(vect2Di(x, bottom), true);
+      setWall(vect2Di(x, top), true);
     }
     for (int y = bottom; y < top+1; y++)
     {
-      board[left][y].wall = true;
-      board[right][y].wall = true;
+      setWall(vect2Di(left, y), true);
+      setWall(vect2Di(right, y), true);
     }
   }
+};
+
+// Every board in the world, which BoardIds index into.  Boards are only ever added, so ids stay good.
+std::vector<std::shared_ptr<Board>> boards;
 
-  void deleteEntity(std::shared_ptr<Entity> entity)
+Board* BoardId::operator-> () const
+{
+  return boards[index].get();
+}
+
+Board& BoardId::operator* () const
+{
+  return *boards[index];
+}
+
+// Make a new empty board, walled around the edge, and hand back its id.
+// There can be up to MAX_BOARDS, each up to MAX_BOARD_SIDE on a side.
+BoardId addBoard(int width, int height)
+{
+  assert(boards.size() < MAX_BOARDS);
+  assert(width >= 1 && width <= MAX_BOARD_SIDE && height >= 1 && height <= MAX_BOARD_SIDE);
+  BoardId id(static_cast<int>(boards.size()));
+  boards.push_back(std::make_shared<Board>(width, height));
+  boards.back()->id = id;
+  return id;
+}
+
+// A square one
+BoardId addBoard(int size)
+{
+  return addBoard(size, size);
+}
+
+// Roughly how much memory all the boards' planes take up
+size_t boardStorageBytes()
+{
+  size_t total = 0;
+  for (std::shared_ptr<Board>& board : boards)
   {
-    // If 2 shared pointers are equal if they point to the same mote, this should work
-    entities.erase(std::remove(entities.begin(), entities.end(), entity), entities.end());
+    total += board->storageBytes();
   }
-};
+  return total;
+}
 
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef BOARD_ID_H
+#define BOARD_ID_H
+
+struct Board;
+
+// A handle to a board: its index in boards (see board.h).
+// Boards stay in boards for as long as the world does, so unlike a shared_ptr these cost nothing to copy, and can't go stale.
+// A default one is no board, like a null pointer.
+struct BoardId
+{
+  int index = -1;
+
+  BoardId() {}
+  explicit BoardId(int i) : index(i) {}
+
+  bool valid() const
+  {
+    return index >= 0;
+  }
+
+  bool operator== (BoardId b) const
+  {
+    return index == b.index;
+  }
+
+  bool operator!= (BoardId b) const
+  {
+    return index != b.index;
+  }
+
+  // These look the board up in boards, so they're defined after it in board.h
+  Board* operator-> () const;
+  Board& operator* () const;
+};
+
+#endif
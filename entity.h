@@ -2,58 +2,145 @@
 #define MOTE_H
 
 #include "geometry.h"
-#include <memory>
+#include "board_id.h"
+#include <cstdint>
+#include <vector>
 
-struct Board;
+// What an entity does, as bits of its flags
+const uint8_t ENTITY_MOVING = 1;
+const uint8_t ENTITY_HOMING = 2;
+const uint8_t ENTITY_CAN_SHOOT = 4;
+// Does it disappear if it runs into a wall?
+const uint8_t ENTITY_DIE_ON_TOUCH = 8;
 
+const int TURRET_MAX_COOLDOWN = 4;
+const int TURRET_DETECTION_RANGE = 10;
+
+// A handle to an entity, from the EntityStore (see entity_store.h).
+// Once the entity is gone its slot is reused with a new generation, so old ids just stop being alive rather than pointing at whatever took its place.
+struct EntityId
+{
+  int slot = -1;
+  uint32_t generation = 0;
+
+  bool valid() const
+  {
+    return slot >= 0;
+  }
+
+  bool operator== (EntityId b) const
+  {
+    return slot == b.slot && generation == b.generation;
+  }
+
+  bool operator!= (EntityId b) const
+  {
+    return !(*this == b);
+  }
+};
+
+// One entity's components, for making new ones and carrying them between boards.
+// Where entities actually live is EntityArrays.
 struct Entity
 {
   vect2Di pos;
-  std::weak_ptr<Board> board;
-  // These values are relative to the current position. 
+  vect2Di faced_direction = LEFT; // This is so there is consistency when stepping through portals
+  // These values are relative to the current position.
   // if this vector is zero, the mote cannot see the player
   // Set as the player's sight lines are updated
   vect2Di rel_player_pos = vect2Di(0, 0);
-  vect2Di faced_direction = LEFT; // This is so there is consistency when stepping through portals
-  bool moving = false;
-  bool homing = false;
-  bool can_shoot = false;
-  // Does it disappear if it runs into a wall?
-  bool die_on_touch = false;
-  int max_cooldown = 4;
   int cooldown = 0;
-  int detection_range=10;
+  uint8_t flags = 0;
 
-  static Entity arrow(std::shared_ptr<Board> board, vect2Di pos, vect2Di dir)
+  static Entity arrow(vect2Di pos, vect2Di dir)
   {
     Entity arrow;
-    arrow.board = board;
     arrow.pos = pos;
     arrow.faced_direction = dir;
-    arrow.moving = true;
-    arrow.die_on_touch = true;
+    arrow.flags = ENTITY_MOVING | ENTITY_DIE_ON_TOUCH;
     return arrow;
   }
 
-  static Entity mote(std::shared_ptr<Board> board, vect2Di pos)
+  static Entity mote(vect2Di pos)
   {
     Entity mote;
-    mote.board = board;
     mote.pos = pos;
-    mote.moving = true;
-    mote.homing = true;
+    mote.flags = ENTITY_MOVING | ENTITY_HOMING;
     return mote;
   }
 
-  static Entity turret(std::shared_ptr<Board> board, vect2Di pos, vect2Di dir)
+  static Entity turret(vect2Di pos, vect2Di dir)
   {
     Entity turret;
-    turret.board = board;
     turret.pos = pos;
     turret.faced_direction = dir;
-    turret.can_shoot = true;
+    turret.flags = ENTITY_CAN_SHOOT;
     return turret;
   }
 };
 
+// The entities on one board, packed into one array per component so the loops over them only pull in what they use.
+// Entity k is made of element k of every array.  Removing one moves the last entity into its place, so order isn't kept.
+struct EntityArrays
+{
+  std::vector<EntityId> id;
+  std::vector<vect2Di> pos;
+  std::vector<vect2Di> faced_direction;
+  std::vector<vect2Di> rel_player_pos;
+  std::vector<int> cooldown;
+  std::vector<uint8_t> flags;
+
+  int size() const
+  {
+    return static_cast<int>(id.size());
+  }
+
+  // Returns where the new entity is
+  int add(EntityId entity_id, const Entity& entity)
+  {
+    id.push_back(entity_id);
+    pos.push_back(entity.pos);
+    faced_direction.push_back(entity.faced_direction);
+    rel_player_pos.push_back(entity.rel_player_pos);
+    cooldown.push_back(entity.cooldown);
+    flags.push_back(entity.flags);
+    return size() - 1;
+  }
+
+  Entity get(int k) const
+  {
+    Entity entity;
+    entity.pos = pos[k];
+    entity.faced_direction = faced_direction[k];
+    entity.rel_player_pos = rel_player_pos[k];
+    entity.cooldown = cooldown[k];
+    entity.flags = flags[k];
+    return entity;
+  }
+
+  // Removes entity k by moving the last one into its place.  Returns the id of the one that moved, or an invalid id if k was the last.
+  EntityId remove(int k)
+  {
+    int last = size() - 1;
+    EntityId moved;
+    if (k != last)
+    {
+      moved = id[last];
+      id[k] = id[last];
+      pos[k] = pos[last];
+      faced_direction[k] = faced_direction[last];
+      rel_player_pos[k] = rel_player_pos[last];
+      cooldown[k] = cooldown[last];
+      flags[k] = flags[last];
+    }
+    id.pop_back();
+    pos.pop_back();
+    faced_direction.pop_back();
+    rel_player_pos.pop_back();
+    cooldown.pop_back();
+    flags.pop_back();
+    return moved;
+  }
+};
+
 #endif
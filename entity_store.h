@@ -0,0 +1,105 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include "board.h"
+#include "entity.h"
+
+// Hands out EntityIds and keeps track of which board each entity is on and where in that board's EntityArrays it is.
+// Spawning, despawning, and moving an entity to another board are all constant time.
+// Slots of despawned entities are reused, with the generation bumped so any ids still held for the old entity stop being alive.
+struct EntityStore
+{
+  struct Slot
+  {
+    uint32_t generation = 0;
+    BoardId board;
+    // Where the entity is in board's EntityArrays, or -1 if the slot is free
+    int index = -1;
+  };
+  std::vector<Slot> slots;
+  std::vector<int> free_slots;
+
+  bool alive(EntityId id)
+  {
+    return id.slot >= 0 &&
+           id.slot < static_cast<int>(slots.size()) &&
+           slots[id.slot].generation == id.generation &&
+           slots[id.slot].index >= 0;
+  }
+
+  BoardId board(EntityId id)
+  {
+    return slots[id.slot].board;
+  }
+
+  int index(EntityId id)
+  {
+    return slots[id.slot].index;
+  }
+
+  // Puts a new entity on board, at entity.pos
+  EntityId spawn(BoardId board, const Entity& entity)
+  {
+    EntityId id;
+    if (free_slots.empty())
+    {
+      id.slot = static_cast<int>(slots.size());
+      slots.push_back(Slot());
+    }
+    else
+    {
+      id.slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    Slot& slot = slots[id.slot];
+    id.generation = slot.generation;
+    slot.board = board;
+    slot.index = board->entities.add(id, entity);
+    board->setEntity(entity.pos, id);
+    return id;
+  }
+
+  // Does nothing if the entity is already gone
+  void despawn(EntityId id)
+  {
+    if (!alive(id))
+    {
+      return;
+    }
+    Slot& slot = slots[id.slot];
+    Board& board = *slot.board;
+    vect2Di pos = board.entities.pos[slot.index];
+    if (board.getEntity(pos) == id)
+    {
+      board.setEntity(pos, EntityId());
+    }
+    removeFromBoard(slot);
+    slot.index = -1;
+    slot.generation++;
+    free_slots.push_back(id.slot);
+  }
+
+  // Moves the entity's components over to new_board.  Where it is on the board, and what is on which square, is up to the caller.
+  void transfer(EntityId id, BoardId new_board)
+  {
+    Slot& slot = slots[id.slot];
+    Entity entity = slot.board->entities.get(slot.index);
+    removeFromBoard(slot);
+    slot.board = new_board;
+    slot.index = new_board->entities.add(id, entity);
+  }
+
+private:
+  void removeFromBoard(Slot& slot)
+  {
+    EntityId moved = slot.board->entities.remove(slot.index);
+    if (moved.valid())
+    {
+      slots[moved.slot].index = slot.index;
+    }
+  }
+};
+
+EntityStore entity_store;
+
+#endif
@@ -2,9 +2,10 @@
 #define GEOMETRY_H
 
 #include <cmath>
+#include <cstdint>
 #include <vector>
 
-struct mat2Di;
+struct Transform;
 
 struct vect2Di
 {
@@ -23,7 +24,7 @@ struct vect2Di
     this->y = 0;
   }
 
-  vect2Di operator+ (vect2Di b)
+  vect2Di operator+ (vect2Di b) const
   {
     vect2Di c;
     c.x = this->x + b.x;
@@ -31,26 +32,35 @@ struct vect2Di
     return c;
   }
 
-  double angle()
+  double angle() const
   {
     return std::atan2(y, x);
   }
 
   // number of ccw rotations from right
   // 4 ccw rotations to a full circle
-  int ccwRotations()
+  // Rounds to the nearest, with exact diagonals going to the next one ccw (which is what rounding the angle did)
+  int ccwRotations() const
   {
-    return static_cast<int>(std::round((angle()/M_PI * 2 + 4)))%4;
+    if (x > 0 && y >= -x && y < x)
+      return 0;
+    if (y > 0 && x > -y && x <= y)
+      return 1;
+    if (x < 0 && y > x && y <= -x)
+      return 2;
+    if (y < 0 && x >= y && x < -y)
+      return 3;
+    return 0;
   }
 
   // How many ccw rotations to b?
   // 4 ccw rotations to a full circle
-  int rotsTo(vect2Di b)
+  int rotsTo(vect2Di b) const
   {
     return (b.ccwRotations()-ccwRotations()+4)%4;
   }
 
-  vect2Di operator- ()
+  vect2Di operator- () const
   {
     vect2Di c;
     c.x = -this->x;
@@ -58,20 +68,20 @@ struct vect2Di
     return c;
   }
   
-  vect2Di operator* (mat2Di M);
-  void operator*= (mat2Di M);
+  vect2Di operator* (Transform T) const;
+  void operator*= (Transform T);
 
-  vect2Di operator- (vect2Di b)
+  vect2Di operator- (vect2Di b) const
   {
     return (*this)+(-b);
   }
 
-  bool operator== (vect2Di b)
+  bool operator== (vect2Di b) const
   {
     return (this->x==b.x) && (this->y==b.y);
   }
   
-  bool operator!= (vect2Di b)
+  bool operator!= (vect2Di b) const
   {
     return !(*this == b);
   }
@@ -87,7 +97,7 @@ struct vect2Di
     *this += -b;
   }
 
-  vect2Di operator* (int a)
+  vect2Di operator* (int a) const
   {
     vect2Di c;
     c.x = this->x * a;
@@ -102,130 +112,163 @@ struct vect2Di
   }
 };
 
-struct mat2Di
+const vect2Di LEFT = vect2Di(-1, 0);
+const vect2Di RIGHT = vect2Di(1, 0);
+const vect2Di UP = vect2Di(0, 1);
+const vect2Di DOWN = vect2Di(0, -1);
+const vect2Di ZERO = vect2Di(0, 0);
+
+const std::vector<vect2Di> ORTHOGONALS = {RIGHT, UP, LEFT, DOWN};
+
+// Index of an orthogonal unit step into ORTHOGONALS
+int directionIndex(vect2Di step)
 {
-  int m11 = 1;
-  int m12 = 0;
-  int m21 = 0; 
-  int m22 = 1;
+  if (step.x == 1)
+    return 0;
+  else if (step.y == 1)
+    return 1;
+  else if (step.x == -1)
+    return 2;
+  else
+    return 3;
+}
 
-  mat2Di(int m11, int m12, int m21, int m22)
-    : m11(m11)
-    , m12(m12)
-    , m21(m21)
-    , m22(m22)
-  {}
+// The 8 ways of turning and flipping the grid onto itself (the dihedral group D4), which is everything a portal can do to directions.
+// Transform i is a flip of x if i >= 4, then i%4 quarter turns ccw.
+// Vectors are rows, multiplied on the left, so as matrices {m11, m12, m21, m22} a vector v goes to (v.x*m11 + v.y*m21, v.x*m12 + v.y*m22),
+// and A*B is A then B.
+struct TransformMatrix
+{
+  int8_t m11, m12, m21, m22;
+};
 
-  mat2Di()
+constexpr TransformMatrix transformMatrix(int i)
+{
+  // A quarter turn takes (x, y) to (-y, x)
+  TransformMatrix m = {1, 0, 0, 1};
+  if (i >= 4)
+  {
+    m = {-1, 0, 0, 1};
+  }
+  for (int r = 0; r < i % 4; r++)
   {
-    this->m11 = 1;
-    this->m12 = 0;
-    this->m21 = 0;
-    this->m22 = 1;
+    m = {static_cast<int8_t>(-m.m12), m.m11, static_cast<int8_t>(-m.m22), m.m21};
   }
+  return m;
+}
 
-  mat2Di operator+ (mat2Di b)
+constexpr int transformIndex(TransformMatrix m)
+{
+  for (int i = 0; i < 8; i++)
   {
-    mat2Di c;
-    c.m11 = this->m11 + b.m11;
-    c.m12 = this->m12 + b.m12;
-    c.m21 = this->m21 + b.m21;
-    c.m22 = this->m22 + b.m22;
-    return c;
+    TransformMatrix t = transformMatrix(i);
+    if (t.m11 == m.m11 && t.m12 == m.m12 && t.m21 == m.m21 && t.m22 == m.m22)
+    {
+      return i;
+    }
   }
+  return -1;
+}
 
-  mat2Di inversed()
+// Everything about the transforms, worked out by the compiler
+struct TransformTables
+{
+  TransformMatrix matrix[8];
+  uint8_t compose[8][8];
+  uint8_t inverse[8];
+  // Where RIGHT ends up, in ccw rotations
+  uint8_t ccw_rotations[8];
+};
+
+constexpr TransformTables makeTransformTables()
+{
+  TransformTables tables = {};
+  for (int a = 0; a < 8; a++)
   {
-    mat2Di c;
-    int det = m11*m22-m12*m21;
-    c.m11 = m22/det;
-    c.m22 = m11/det;
-    c.m12 = -m12/det;
-    c.m21 = -m21/det;
-    return c;
+    tables.matrix[a] = transformMatrix(a);
+  }
+  for (int a = 0; a < 8; a++)
+  {
+    for (int b = 0; b < 8; b++)
+    {
+      TransformMatrix A = tables.matrix[a];
+      TransformMatrix B = tables.matrix[b];
+      TransformMatrix AB = {static_cast<int8_t>(A.m11*B.m11 + A.m12*B.m21), static_cast<int8_t>(A.m11*B.m12 + A.m12*B.m22),
+                            static_cast<int8_t>(A.m21*B.m11 + A.m22*B.m21), static_cast<int8_t>(A.m21*B.m12 + A.m22*B.m22)};
+      tables.compose[a][b] = transformIndex(AB);
+      if (transformIndex(AB) == 0)
+      {
+        tables.inverse[a] = b;
+      }
+    }
+    // RIGHT goes to the first row of the matrix
+    TransformMatrix A = tables.matrix[a];
+    tables.ccw_rotations[a] = A.m11 == 1 ? 0 : A.m12 == 1 ? 1 : A.m11 == -1 ? 2 : 3;
   }
+  return tables;
+}
+
+constexpr TransformTables TRANSFORM_TABLES = makeTransformTables();
 
-  mat2Di operator- ()
+// A portal transform (rotations and reflections), as one of the 8 elements of D4
+struct Transform
+{
+  uint8_t index = 0;
+
+  constexpr Transform() {}
+  constexpr explicit Transform(int i) : index(i) {}
+
+  constexpr Transform operator* (Transform b) const
   {
-    mat2Di c;
-    c.m11 = -this->m11;
-    c.m12 = -this->m12;
-    c.m21 = -this->m21;
-    c.m22 = -this->m22;
-    return c;
+    return Transform(TRANSFORM_TABLES.compose[index][b.index]);
   }
 
-  mat2Di operator- (mat2Di b)
+  void operator*= (Transform b)
   {
-    return (*this)+(-b);
+    index = TRANSFORM_TABLES.compose[index][b.index];
   }
 
-  vect2Di operator* (vect2Di a)
+  constexpr Transform inversed() const
   {
-    vect2Di c;
-    c.x = a.x * this->m11 + a.y * this->m21;
-    c.y = a.x * this->m12 + a.y * this->m22;
-    return c;
+    return Transform(TRANSFORM_TABLES.inverse[index]);
   }
 
-  mat2Di operator* (mat2Di b)
+  constexpr bool operator== (Transform b) const
   {
-    mat2Di c;
-    c.m11 = m11*b.m11 + m12*b.m21;
-    c.m12 = m11*b.m12 + m12*b.m22;
-    c.m21 = m21*b.m11 + m22*b.m21;
-    c.m22 = m21*b.m12 + m22*b.m22;
-    return c;
+    return index == b.index;
   }
 
-  void operator*= (mat2Di b)
+  constexpr bool operator!= (Transform b) const
   {
-    mat2Di c;
-    c.m11 = m11*b.m11 + m12*b.m21;
-    c.m12 = m11*b.m12 + m12*b.m22;
-    c.m21 = m21*b.m11 + m22*b.m21;
-    c.m22 = m21*b.m12 + m22*b.m22;
-    m11=c.m11;
-    m12=c.m12;
-    m21=c.m21;
-    m22=c.m22;
+    return index != b.index;
   }
 
-  // This should really only work with combinations of simple 90 degree rotators
-  int ccwRotations()
+  constexpr int ccwRotations() const
   {
-    return (vect2Di(1, 0) * *this).ccwRotations();
+    return TRANSFORM_TABLES.ccw_rotations[index];
   }
 };
 
-vect2Di vect2Di::operator* (struct mat2Di M)
+vect2Di vect2Di::operator* (Transform T) const
 {
-  vect2Di c;
-  c.x = this->x * M.m11 + this->y * M.m21;
-  c.y = this->x * M.m12 + this->y * M.m22;
-  return c;
+  const TransformMatrix& M = TRANSFORM_TABLES.matrix[T.index];
+  return vect2Di(x * M.m11 + y * M.m21, x * M.m12 + y * M.m22);
 }
-void vect2Di::operator*= (struct mat2Di M)
+
+void vect2Di::operator*= (Transform T)
 {
-  vect2Di c = *this * M;
-  this->x = c.x;
-  this->y = c.y;
+  *this = *this * T;
 }
 
+constexpr Transform IDENTITY = Transform(transformIndex({1, 0, 0, 1}));
+constexpr Transform CCW = Transform(transformIndex({0, 1, -1, 0}));
+constexpr Transform CW = Transform(transformIndex({0, -1, 1, 0}));
+constexpr Transform FLIP_X = Transform(transformIndex({-1, 0, 0, 1}));
+constexpr Transform FLIP_Y = Transform(transformIndex({1, 0, 0, -1}));
 
-const vect2Di LEFT = vect2Di(-1, 0);
-const vect2Di RIGHT = vect2Di(1, 0);
-const vect2Di UP = vect2Di(0, 1);
-const vect2Di DOWN = vect2Di(0, -1);
-const vect2Di ZERO = vect2Di(0, 0);
-
-const std::vector<vect2Di> ORTHOGONALS = {RIGHT, UP, LEFT, DOWN};
-
-const mat2Di IDENTITY = mat2Di(1,0,0,1);
-const mat2Di CCW = mat2Di(0,1,-1,0);
-const mat2Di CW = mat2Di(0,-1,1,0);
-const mat2Di FLIP_X = mat2Di(-1,0,0,1);
-const mat2Di FLIP_Y = mat2Di(1,0,0,-1);
+static_assert(sizeof(Transform) == 1, "a transform should fit in a byte");
+static_assert(CCW * CCW * CCW == CW, "three quarter turns ccw are one cw");
+static_assert((FLIP_X * CCW).inversed() == FLIP_X * CCW, "a reflection is its own inverse");
 
 
 
@@ -2,33 +2,219 @@
 #define LINE_H
 
 #include <vector>
+#include <deque>
+#include <cstdint>
 #include "geometry.h"
 #include <ncursesw/ncurses.h>
-#include <memory>
-
-struct Board;
+#include "board_id.h"
 
 struct SquareMap
 {
   // in the board's frame of reference (absolute)
-  std::shared_ptr<Board> board;
+  BoardId board;
   vect2Di board_pos;
 
   // relative to the line's starting position
   vect2Di line_pos;
 
   // portal induced transforms (including rotations and reflections)
-  mat2Di transform = IDENTITY;
+  Transform transform = IDENTITY;
 
   // A color tint from going through portals
   int color = COLOR_WHITE;
 };
 
+// A run of a line's squares that are on the same board and seen through the same portals, so those are only stored once.
+// It starts at squares[first] of the line and goes up to the next segment's first.
+struct LineSegment
+{
+  BoardId board;
+  Transform transform;
+  uint8_t color;
+  int first;
+};
+
+// Where one square of a line is, as small ints.  Boards are at most MAX_BOARD_SIDE across, and sight is well under that.
+struct LineSquare
+{
+  int16_t board_x;
+  int16_t board_y;
+  int16_t line_x;
+  int16_t line_y;
+
+  vect2Di boardPos() const
+  {
+    return vect2Di(board_x, board_y);
+  }
+
+  vect2Di linePos() const
+  {
+    return vect2Di(line_x, line_y);
+  }
+};
+
+// The squares a line goes through, in order from the line's start to its end.
+// They're stored a segment at a time, and read back out as SquareMaps.
 class Line
 {
 public:
-  // In order from the line's start to its end
-  std::vector<SquareMap> mappings;
+  std::vector<LineSegment> segments;
+  std::vector<LineSquare> squares;
+
+  class Iterator
+  {
+  public:
+    Iterator(const Line* line, int i, int segment)
+      : line(line), i(i), segment(segment)
+    {}
+
+    SquareMap operator* () const
+    {
+      return line->mapping(i, segment);
+    }
+
+    void operator++ ()
+    {
+      i++;
+      if (segment + 1 < static_cast<int>(line->segments.size()) && line->segments[segment + 1].first == i)
+      {
+        segment++;
+      }
+    }
+
+    bool operator!= (const Iterator& b) const
+    {
+      return i != b.i;
+    }
+
+  private:
+    const Line* line;
+    int i;
+    int segment;
+  };
+
+  int size() const
+  {
+    return static_cast<int>(squares.size());
+  }
+
+  bool empty() const
+  {
+    return squares.empty();
+  }
+
+  // Where segment s ends: the first square after it
+  int segmentEnd(int s) const
+  {
+    return s + 1 < static_cast<int>(segments.size()) ? segments[s + 1].first : size();
+  }
+
+  // Keeps the storage
+  void clear()
+  {
+    segments.clear();
+    squares.clear();
+  }
+
+  // Makes this the first n squares of other
+  void assignPrefix(const Line& other, int n)
+  {
+    clear();
+    squares.assign(other.squares.begin(), other.squares.begin() + n);
+    for (const LineSegment& segment : other.segments)
+    {
+      if (segment.first >= n)
+      {
+        break;
+      }
+      segments.push_back(segment);
+    }
+  }
+
+  // Adds a square to the end, starting a new segment if it isn't like the last one
+  void push_back(const SquareMap& mapping)
+  {
+    if (segments.empty() ||
+        segments.back().board != mapping.board ||
+        segments.back().transform != mapping.transform ||
+        segments.back().color != mapping.color)
+    {
+      LineSegment segment;
+      segment.board = mapping.board;
+      segment.transform = mapping.transform;
+      segment.color = mapping.color;
+      segment.first = size();
+      segments.push_back(segment);
+    }
+    LineSquare square;
+    square.board_x = mapping.board_pos.x;
+    square.board_y = mapping.board_pos.y;
+    square.line_x = mapping.line_pos.x;
+    square.line_y = mapping.line_pos.y;
+    squares.push_back(square);
+  }
+
+  // Square i, looking up its segment.  Going through the line in order with begin() and end() saves the lookup.
+  SquareMap operator[] (int i) const
+  {
+    int segment = static_cast<int>(segments.size()) - 1;
+    while (segments[segment].first > i)
+    {
+      segment--;
+    }
+    return mapping(i, segment);
+  }
+
+  Iterator begin() const
+  {
+    return Iterator(this, 0, 0);
+  }
+
+  Iterator end() const
+  {
+    return Iterator(this, size(), 0);
+  }
+
+private:
+  SquareMap mapping(int i, int segment) const
+  {
+    const LineSegment& s = segments[segment];
+    const LineSquare& square = squares[i];
+    SquareMap mapping;
+    mapping.board = s.board;
+    mapping.board_pos = square.boardPos();
+    mapping.line_pos = square.linePos();
+    mapping.transform = s.transform;
+    mapping.color = s.color;
+    return mapping;
+  }
+};
+
+// Lines that only have to last until the end of the turn, like the steps and shots cast while the world updates.
+// They are handed out one after another, and the arena is reset at the start of every turn.
+// The lines keep their storage through that, so once the arena has seen a busy turn, casting them allocates nothing.
+struct LineArena
+{
+  // a deque, so handing out another line doesn't move the ones already out
+  std::deque<Line> lines;
+  int used = 0;
+
+  // An empty line, good until the next reset
+  Line& next()
+  {
+    if (used == static_cast<int>(lines.size()))
+    {
+      lines.emplace_back();
+    }
+    Line& line = lines[used++];
+    line.clear();
+    return line;
+  }
+
+  void reset()
+  {
+    used = 0;
+  }
 };
 
 #endif
@@ -0,0 +1,108 @@
+#ifndef MEMORY_MAP_H
+#define MEMORY_MAP_H
+
+#include "geometry.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// What the player remembers seeing, as the glyphs last drawn there, in a square around the player that moves with them.
+// The squares wrap around (the map is a torus with a moving origin), so moving only shifts the origin
+// and blanks the row or column that comes into view, rather than copying the whole map.
+struct MemoryMap
+{
+  int size = 0;
+  // Where position (0, 0) is in cells
+  vect2Di origin = vect2Di(0, 0);
+  std::vector<const wchar_t*> cells;
+
+  MemoryMap(int size)
+  {
+    resize(size);
+  }
+
+  // Forgets everything
+  void resize(int new_size)
+  {
+    size = new_size;
+    origin = vect2Di(0, 0);
+    cells.assign(size * size, L" ");
+  }
+
+  bool contains(vect2Di pos)
+  {
+    return pos.x >= 0 && pos.x < size && pos.y >= 0 && pos.y < size;
+  }
+
+  // A blank for anywhere off the map
+  const wchar_t* get(vect2Di pos)
+  {
+    if (!contains(pos))
+    {
+      return L" ";
+    }
+    return cells[cellIndex(pos)];
+  }
+
+  void set(vect2Di pos, const wchar_t* glyph)
+  {
+    if (contains(pos))
+    {
+      cells[cellIndex(pos)] = glyph;
+    }
+  }
+
+  // The player has just moved by player_movement, so the map shifts in the opposite direction: pos now shows what was at pos + player_movement.
+  // Squares that come in from past the edge are blank.
+  void shift(vect2Di player_movement)
+  {
+    if (std::abs(player_movement.x) >= size || std::abs(player_movement.y) >= size)
+    {
+      resize(size);
+      return;
+    }
+    origin = vect2Di(wrap(origin.x + player_movement.x), wrap(origin.y + player_movement.y));
+    // the columns and rows that wrapped around from the other side
+    int first_x = player_movement.x > 0 ? size - player_movement.x : 0;
+    for (int x = first_x; x < first_x + std::abs(player_movement.x); x++)
+    {
+      // a column is a run of cells
+      int start = cellIndex(vect2Di(x, 0)) - origin.y;
+      std::fill(cells.begin() + start, cells.begin() + start + size, L" ");
+    }
+    int first_y = player_movement.y > 0 ? size - player_movement.y : 0;
+    for (int y = first_y; y < first_y + std::abs(player_movement.y); y++)
+    {
+      // and a row is every size'th cell
+      for (int i = cellIndex(vect2Di(0, y)) - origin.x * size; i < size * size; i += size)
+      {
+        cells[i] = L" ";
+      }
+    }
+  }
+
+private:
+  int wrap(int i)
+  {
+    i %= size;
+    return i < 0 ? i + size : i;
+  }
+
+  // pos has to be on the map
+  int cellIndex(vect2Di pos)
+  {
+    int x = pos.x + origin.x;
+    int y = pos.y + origin.y;
+    if (x >= size)
+    {
+      x -= size;
+    }
+    if (y >= size)
+    {
+      y -= size;
+    }
+    return x * size + y;
+  }
+};
+
+#endif
@@ -3,15 +3,15 @@
 
 #include "geometry.h"
 #include <ncursesw/ncurses.h>
-#include <memory>
-
-struct Board;
+#include "board_id.h"
 
+// Portals are shared between all the edges of a board that lead to the same place, so they only hold the destination relative to the square you would have stepped into.
 struct Portal
 {
-  vect2Di new_pos;
-  std::weak_ptr<Board> new_board;
-  mat2Di transform;
+  // Where you end up, relative to where the step would have taken you without the portal
+  vect2Di offset;
+  BoardId new_board;
+  Transform transform;
   int color = COLOR_WHITE; // white is unchanged, otherwise tints by color (maybe black does something else)
 };
 
@@ -0,0 +1,85 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <utility>
+
+// splitmix64's finalizer, for turning seeds and stream keys into well mixed bits
+uint64_t mixBits(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// xoshiro256**: small, fast, and the same numbers on every platform for the same seed.
+// Rather than sharing one generator, things that need randomness make their own stream from a seed and some keys
+// (see Rng::stream), so they get the same numbers no matter what order, or on what thread, they run in.
+struct Rng
+{
+  uint64_t state[4];
+
+  Rng(uint64_t seed = 0)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      seed = mixBits(seed);
+      state[i] = seed;
+    }
+  }
+
+  // A stream for one combination of keys, e.g. (world seed, subsystem, board, tick)
+  static Rng stream(uint64_t seed, uint64_t a, uint64_t b = 0, uint64_t c = 0, uint64_t d = 0)
+  {
+    uint64_t key = mixBits(seed);
+    key = mixBits(key ^ a);
+    key = mixBits(key ^ b);
+    key = mixBits(key ^ c);
+    key = mixBits(key ^ d);
+    return Rng(key);
+  }
+
+  uint64_t next()
+  {
+    uint64_t result = rotl(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+  }
+
+  // range : [min, max), and just min (without using up a number) if they're the same, like random()
+  int range(int min, int max)
+  {
+    if (max == min)
+    {
+      return min;
+    }
+    uint64_t span = static_cast<uint64_t>(max - min);
+    return min + static_cast<int>(((next() >> 32) * span) >> 32);
+  }
+
+  // Fisher-Yates
+  template <typename Iterator>
+  void shuffle(Iterator first, Iterator last)
+  {
+    int n = static_cast<int>(last - first);
+    for (int i = n - 1; i > 0; i--)
+    {
+      int j = range(0, i + 1);
+      std::swap(first[i], first[j]);
+    }
+  }
+
+  static uint64_t rotl(uint64_t x, int k)
+  {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+#endif
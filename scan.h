@@ -0,0 +1,178 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+// Kernels that compare up to 64 cells of a plane against a threshold at once, and return the cells that pass as one word of a mask,
+// bit k for cell k, the same layout as a BitPlane word.  Masks of different planes then combine with plain word operations,
+// so a predicate over a whole stretch of a board is a handful of vector compares per 64 cells rather than a branch per cell.
+//
+// There is a scalar, an SSE2, and an AVX2 version of each.  scan_kernels holds the best ones this CPU has, picked when the program starts.
+// The vector versions only do whole words, and hand anything shorter (the end of a board) to the scalar ones.
+
+enum ScanLevel
+{
+  SCAN_SCALAR,
+  SCAN_SSE2,
+  SCAN_AVX2
+};
+
+const char* const SCAN_LEVEL_NAMES[] = {"scalar", "sse2", "avx2"};
+
+struct ScanKernels
+{
+  ScanLevel level;
+  // Bits set for values[k] > threshold, k < n <= 64
+  uint64_t (*above16)(const uint16_t* values, int n, int threshold);
+  uint64_t (*above8)(const uint8_t* values, int n, int threshold);
+};
+
+uint64_t scalarAbove16(const uint16_t* values, int n, int threshold)
+{
+  uint64_t mask = 0;
+  for (int k = 0; k < n; k++)
+  {
+    mask |= uint64_t(values[k] > threshold) << k;
+  }
+  return mask;
+}
+
+uint64_t scalarAbove8(const uint8_t* values, int n, int threshold)
+{
+  uint64_t mask = 0;
+  for (int k = 0; k < n; k++)
+  {
+    mask |= uint64_t(values[k] > threshold) << k;
+  }
+  return mask;
+}
+
+#ifdef SCAN_X86
+
+// There are only signed compares, so both sides get their top bit flipped first, which keeps the order of unsigned values
+
+__attribute__((target("sse2")))
+uint64_t sse2Above16(const uint16_t* values, int n, int threshold)
+{
+  if (n < 64 || threshold < 0 || threshold > UINT16_MAX)
+  {
+    return scalarAbove16(values, n, threshold);
+  }
+  const __m128i flip = _mm_set1_epi16(-0x8000);
+  const __m128i limit = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(threshold)), flip);
+  uint64_t mask = 0;
+  for (int k = 0; k < 64; k += 16)
+  {
+    __m128i low = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + k)), flip);
+    __m128i high = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + k + 8)), flip);
+    // narrowing the 16 bit results to bytes keeps them in order, one movemask bit per value
+    __m128i bytes = _mm_packs_epi16(_mm_cmpgt_epi16(low, limit), _mm_cmpgt_epi16(high, limit));
+    mask |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(bytes))) << k;
+  }
+  return mask;
+}
+
+__attribute__((target("sse2")))
+uint64_t sse2Above8(const uint8_t* values, int n, int threshold)
+{
+  if (n < 64 || threshold < 0 || threshold > UINT8_MAX)
+  {
+    return scalarAbove8(values, n, threshold);
+  }
+  const __m128i flip = _mm_set1_epi8(-0x80);
+  const __m128i limit = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(threshold)), flip);
+  uint64_t mask = 0;
+  for (int k = 0; k < 64; k += 16)
+  {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + k)), flip);
+    mask |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit)))) << k;
+  }
+  return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t avx2Above16(const uint16_t* values, int n, int threshold)
+{
+  if (n < 64 || threshold < 0 || threshold > UINT16_MAX)
+  {
+    return scalarAbove16(values, n, threshold);
+  }
+  const __m256i flip = _mm256_set1_epi16(-0x8000);
+  const __m256i limit = _mm256_xor_si256(_mm256_set1_epi16(static_cast<short>(threshold)), flip);
+  uint64_t mask = 0;
+  for (int k = 0; k < 64; k += 32)
+  {
+    __m256i low = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k)), flip);
+    __m256i high = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k + 16)), flip);
+    // packs works within each 128 bit half, so the quarters come out as low, high, low, high and need putting back in order
+    __m256i bytes = _mm256_packs_epi16(_mm256_cmpgt_epi16(low, limit), _mm256_cmpgt_epi16(high, limit));
+    bytes = _mm256_permute4x64_epi64(bytes, 0xd8);
+    mask |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(bytes))) << k;
+  }
+  return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t avx2Above8(const uint8_t* values, int n, int threshold)
+{
+  if (n < 64 || threshold < 0 || threshold > UINT8_MAX)
+  {
+    return scalarAbove8(values, n, threshold);
+  }
+  const __m256i flip = _mm256_set1_epi8(-0x80);
+  const __m256i limit = _mm256_xor_si256(_mm256_set1_epi8(static_cast<char>(threshold)), flip);
+  uint64_t mask = 0;
+  for (int k = 0; k < 64; k += 32)
+  {
+    __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + k)), flip);
+    mask |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)))) << k;
+  }
+  return mask;
+}
+
+#endif
+
+// The best level this CPU can run
+ScanLevel bestScanLevel()
+{
+#ifdef SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return SCAN_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2"))
+  {
+    return SCAN_SSE2;
+  }
+#endif
+  return SCAN_SCALAR;
+}
+
+// The kernels for a level, which has to be one the CPU can run
+ScanKernels scanKernels(ScanLevel level)
+{
+  ScanKernels kernels = {SCAN_SCALAR, scalarAbove16, scalarAbove8};
+#ifdef SCAN_X86
+  if (level == SCAN_SSE2)
+  {
+    kernels = {SCAN_SSE2, sse2Above16, sse2Above8};
+  }
+  if (level == SCAN_AVX2)
+  {
+    kernels = {SCAN_AVX2, avx2Above16, avx2Above8};
+  }
+#else
+  (void)level;
+#endif
+  return kernels;
+}
+
+ScanKernels scan_kernels = scanKernels(bestScanLevel());
+
+#endif
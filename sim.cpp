@@ -0,0 +1,139 @@
+
+// Runs the world without a terminal, for timing the simulation.
+//
+// usage: labyrinth_sim [--ticks N] [--input KEYS] [--sight rays|shadowcast] [--seed N] [--threads N] [--tile CELLS] [--boards N] [--board-size WxH]
+//
+// KEYS are the same keys the game takes ("hjkl" to move, space for the laser, and so on), one per tick.
+// They are repeated for as many ticks as are asked for.  With no input the player just stands there.
+// --sight picks how the player's sight is worked out, so the two can be timed against each other.
+// The same seed and input always give the same world, and the checksum printed at the end says so.
+// That holds for any number of --threads too (the default is one per core).
+// --tile splits boards into tiles of that many cells so one big board can use every thread (see tile_cells).
+// Tiled runs are repeatable too, but come out different from untiled ones.
+// --boards runs a generated level of that many boards of --board-size (default 100x100) instead of the test map (see initSprawlWorld).
+
+#include "world.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <chrono>
+
+void printUsage()
+{
+  fprintf(stderr, "usage: labyrinth_sim [--ticks N] [--input KEYS] [--sight rays|shadowcast] [--seed N] [--threads N] [--tile CELLS] [--boards N] [--board-size WxH]\n");
+}
+
+int main(int argc, char** argv)
+{
+  int num_ticks = 1000;
+  uint64_t seed = 1;
+  std::string input;
+  int num_boards = 0;
+  int board_width = 100;
+  int board_height = 100;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--ticks") == 0 && i+1 < argc)
+    {
+      num_ticks = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--input") == 0 && i+1 < argc)
+    {
+      input = argv[++i];
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && i+1 < argc)
+    {
+      seed = strtoull(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--tile") == 0 && i+1 < argc)
+    {
+      tile_cells = std::max(0, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc)
+    {
+      worker_threads = std::max(1, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--boards") == 0 && i+1 < argc)
+    {
+      num_boards = std::max(1, atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--board-size") == 0 && i+1 < argc)
+    {
+      if (sscanf(argv[++i], "%dx%d", &board_width, &board_height) != 2)
+      {
+        printUsage();
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--sight") == 0 && i+1 < argc)
+    {
+      i++;
+      if (strcmp(argv[i], "rays") == 0)
+      {
+        sight_mode = SIGHT_RAYS;
+      }
+      else if (strcmp(argv[i], "shadowcast") == 0)
+      {
+        sight_mode = SIGHT_SHADOWCAST;
+      }
+      else
+      {
+        printUsage();
+        return 1;
+      }
+    }
+    else
+    {
+      printUsage();
+      return 1;
+    }
+  }
+
+  seedWorld(seed);
+  if (num_boards > 0)
+  {
+    initSprawlWorld(num_boards, board_width, board_height);
+  }
+  else
+  {
+    initWorld();
+  }
+
+  PhaseTimes times;
+  double input_seconds = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < num_ticks; tick++)
+  {
+    std::chrono::steady_clock::time_point input_start = std::chrono::steady_clock::now();
+    bool laser_fired = false;
+    if (!input.empty())
+    {
+      laser_fired = handleInput(input[tick % input.size()]);
+    }
+    input_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - input_start).count();
+
+    tickWorld(laser_fired, &times);
+  }
+  double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("ticks: %d\n", num_ticks);
+  printf("threads: %d\n", worker_threads);
+  printf("tile cells: %d\n", tile_cells);
+  printf("boards: %d\n", static_cast<int>(boards.size()));
+  printf("board storage: %.1f MB\n", boardStorageBytes() / 1e6);
+  printf("total: %.3f s\n", total_seconds);
+  printf("ticks/sec: %.1f\n", num_ticks / total_seconds);
+  printf("\n%-10s %12s %12s %8s\n", "phase", "total ms", "us/tick", "share");
+  for (int phase = 0; phase < NUM_PHASES; phase++)
+  {
+    double seconds = times.seconds[phase];
+    printf("%-10s %12.3f %12.3f %7.1f%%\n", PHASE_NAMES[phase], seconds * 1e3, seconds * 1e6 / num_ticks, 100 * seconds / total_seconds);
+  }
+  printf("%-10s %12.3f %12.3f %7.1f%%\n", "input", input_seconds * 1e3, input_seconds * 1e6 / num_ticks, 100 * input_seconds / total_seconds);
+  printf("\nseed: %llu\n", static_cast<unsigned long long>(seed));
+  printf("checksum: %016llx\n", static_cast<unsigned long long>(worldChecksum()));
+  return 0;
+}
@@ -0,0 +1,139 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that parallelFor hands indices out to.
+// The calling thread works too, so a pool of 1 thread has no workers and just runs everything in place.
+class ThreadPool
+{
+public:
+  ThreadPool(int num_threads)
+  {
+    for (int i = 1; i < num_threads; i++)
+    {
+      workers.emplace_back([this]() { workerLoop(); });
+    }
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  int numThreads()
+  {
+    return static_cast<int>(workers.size()) + 1;
+  }
+
+  // Calls body(i) for every i in [0, n), spread over the threads, and returns once they have all finished.
+  // Which thread gets which index is up to chance, so body(i) should only touch things that belong to i.
+  // body is only borrowed for the call, so nothing is allocated to hold it.
+  template <typename Body>
+  void parallelFor(int n, const Body& body)
+  {
+    run(n, &body, [](const void* context, int i) { (*static_cast<const Body*>(context))(i); });
+  }
+
+private:
+  typedef void (*JobCall)(const void* context, int i);
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  const void* job_context = nullptr;
+  JobCall job_call = nullptr;
+  int job_size = 0;
+  std::atomic<int> next_index{0};
+  int busy_workers = 0;
+  int generation = 0;
+  bool stopping = false;
+
+  void run(int n, const void* context, JobCall call)
+  {
+    if (workers.empty() || n <= 1)
+    {
+      for (int i = 0; i < n; i++)
+      {
+        call(context, i);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job_context = context;
+      job_call = call;
+      job_size = n;
+      next_index = 0;
+      busy_workers = static_cast<int>(workers.size());
+      generation++;
+    }
+    wake.notify_all();
+    runJob(context, call, n);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]() { return busy_workers == 0; });
+    job_context = nullptr;
+    job_call = nullptr;
+  }
+
+  void runJob(const void* context, JobCall call, int n)
+  {
+    while (true)
+    {
+      int i = next_index.fetch_add(1);
+      if (i >= n)
+      {
+        break;
+      }
+      call(context, i);
+    }
+  }
+
+  void workerLoop()
+  {
+    int seen_generation = 0;
+    while (true)
+    {
+      const void* context;
+      JobCall call;
+      int n;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&]() { return stopping || generation != seen_generation; });
+        if (stopping)
+        {
+          return;
+        }
+        seen_generation = generation;
+        context = job_context;
+        call = job_call;
+        n = job_size;
+      }
+      runJob(context, call, n);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy_workers--;
+        if (busy_workers == 0)
+        {
+          finished.notify_one();
+        }
+      }
+    }
+  }
+};
+
+#endif
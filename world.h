@@ -0,0 +1,2757 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "board.h"
+#include "line.h"
+#include "portal.h"
+#include "entity.h"
+#include "entity_store.h"
+#include "geometry.h"
+#include "memory_map.h"
+#include "rng.h"
+#include "thread_pool.h"
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Everything about the game world that doesn't need a terminal: the boards, the player, and the rules that advance them each turn.
+
+const int BOARD_SIZE = 100;
+const int MEMORY_MAP_SIZE = 101;
+const int SIGHT_RADIUS = 30;
+const bool PORTALS_OFF = false;
+// How many steps away motes can find their way to the player from
+const int PURSUIT_RANGE = 60;
+
+const int PLANT_MAX_HEALTH = 10;
+const int AVG_PLANT_SPAWN_TIME = 20;
+const int AVG_FIRE_SPREAD_TIME = 2;
+
+const int SHALLOW_WATER_DEPTH = 3;
+const int AVG_WATER_FLOW_TIME = 1;
+
+const int STEAM_PER_WATER = 100;
+
+// Each system that uses randomness during a turn gets its own stream per board per turn (see tickRng)
+enum RngSubsystem
+{
+  RNG_FIRE,
+  RNG_PLANTS,
+  RNG_WATER,
+  RNG_STEAM,
+  RNG_ENTITIES
+};
+
+// The phases of a turn, in the order tickWorld runs them
+enum Phase
+{
+  PHASE_FIRE,
+  PHASE_LASER,
+  PHASE_PLANTS,
+  PHASE_WATER,
+  PHASE_STEAM,
+  PHASE_SIGHT,
+  PHASE_ENTITIES,
+  NUM_PHASES
+};
+const char* const PHASE_NAMES[NUM_PHASES] = {"fire", "laser", "plants", "water", "steam", "sight", "entities"};
+
+// Seconds spent in each phase, accumulated over calls to tickWorld
+struct PhaseTimes
+{
+  double seconds[NUM_PHASES] = {};
+};
+
+
+std::pair<BoardId, vect2Di> posFromStep(BoardId start_board, vect2Di start_pos, vect2Di step);
+void orthogonalRedirect(BoardId start_board, vect2Di start_pos, vect2Di step, BoardId& end_board, vect2Di& end_pos, Transform& portal_transform);
+bool stepCell(Board& board, int cell, int dir, Board*& end_board, int& end_cell);
+Line& curveCast(BoardId board, const std::vector<vect2Di>& naive_squares, bool is_sight_line=false);
+void curveCast(Line& line, BoardId start_board, vect2Di start_pos, const vect2Di* naive_squares, int num_squares, bool is_sight_line=false, Transform start_transform=IDENTITY);
+void curveCastBatch(Line** lines, int num_lines, BoardId start_board, vect2Di start_pos, Transform start_transform,
+                    const vect2Di* squares, const int* starts, const int* shared);
+void updateSightLines();
+void invalidateSight();
+void shadowcastSight();
+Line& lineCast(BoardId start_board, vect2Di start_pos, vect2Di d_pos, bool is_sight_line=false);
+Transform transformFromStep(BoardId start_board, vect2Di start_pos, vect2Di step);
+
+//TODO: make these non-global
+MemoryMap memory_map(MEMORY_MAP_SIZE);
+std::vector<Line> player_sight_lines;
+// Where lineCast and curveCast get the lines they return, reset every turn
+LineArena line_arena;
+vect2Di player_pos;
+BoardId player_board;
+// How far the player can see, defaults to SIGHT_RADIUS
+int sight_radius = SIGHT_RADIUS;
+// Sight rays are the original way of seeing, shadowcasting visits every seen square once
+enum SightMode
+{
+  SIGHT_RAYS,
+  SIGHT_SHADOWCAST
+};
+SightMode sight_mode = SIGHT_RAYS;
+// Motes find their way to the player along the pursuit field, or, the original way, head straight for where they last saw the player
+enum PursuitMode
+{
+  PURSUIT_FIELD,
+  PURSUIT_SIGHT
+};
+PursuitMode pursuit_mode = PURSUIT_FIELD;
+int consecutive_laser_rounds = 0;
+vect2Di player_faced_direction = RIGHT;
+// How many threads the per-board updates are spread over
+int worker_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+// Everything random in the world comes from this, so the same seed and input give the same game
+uint64_t world_seed = 0;
+// How many turns have gone by
+int world_tick = 0;
+// This is visual only, its a transform for drawing to the screen and changing the direction of movement inputs.
+Transform player_transform;
+
+// The pool of worker_threads threads, made again if worker_threads changes
+ThreadPool& workerPool()
+{
+  static std::unique_ptr<ThreadPool> pool;
+  if (pool == nullptr || pool->numThreads() != worker_threads)
+  {
+    pool.reset(new ThreadPool(worker_threads));
+  }
+  return *pool;
+}
+
+// Start the world's randomness over from a seed.  Call before initWorld for a repeatable world.
+void seedWorld(uint64_t seed)
+{
+  world_seed = seed;
+  world_tick = 0;
+  randomStream() = Rng(seed);
+}
+
+// The random stream for one subsystem on one board this turn
+Rng tickRng(RngSubsystem subsystem, int board_index)
+{
+  return Rng::stream(world_seed, subsystem, board_index, world_tick);
+}
+
+bool posIsEmpty(BoardId board, vect2Di pos)
+{
+  // Square must be empty and also actually be there
+  if (!board->onBoard(pos) ||
+      board->hasEntity(pos) ||
+      board->getWall(pos) != false ||
+      board->getWater(pos) != 0 ||
+      board->getPlant(pos) != 0 ||
+      board->getFire(pos) != false ||
+      pos == player_pos)
+  {
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+bool posIsWalkable(BoardId board, vect2Di pos)
+{
+  // Square must be empty and also actually be there
+  if (!board->onBoard(pos) ||
+      board->hasEntity(pos) ||
+      board->getWall(pos) != false ||
+      board->getWater(pos) > SHALLOW_WATER_DEPTH ||
+      board->getPlant(pos) != 0 ||
+      board->getFire(pos) != false ||
+      pos == player_pos)
+  {
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+// posIsWalkable for a cell of a board, for the inner loops
+bool cellIsWalkable(Board& board, int cell)
+{
+  if (board.occupants.get(cell).valid() ||
+      board.getWall(cell) != false ||
+      board.getWater(cell) > SHALLOW_WATER_DEPTH ||
+      board.getPlant(cell) != 0 ||
+      board.getFire(cell) != false ||
+      (board.onBoard(player_pos) && cell == board.cellIndex(player_pos)))
+  {
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+bool posIsFlyable(BoardId board, vect2Di pos)
+{
+  // Square must be empty and also actually be there
+  if (!board->onBoard(pos) ||
+      board->hasEntity(pos) ||
+      board->getWall(pos) != false ||
+      board->getPlant(pos) != 0 ||
+      pos == player_pos)
+  {
+    return false;
+  }
+  else
+  {
+    return true;
+  }
+}
+
+void attemptMove(vect2Di dp, bool voluntaryMove = true)
+{
+  if (voluntaryMove)
+  {
+    player_faced_direction = dp;
+  }
+  Line& line = lineCast(player_board, player_pos, dp);
+  if (!line.empty())
+  {
+    vect2Di pos = line[0].board_pos;
+    BoardId board = line[0].board;
+    if (posIsWalkable(board, pos))
+    {
+      memory_map.shift(dp * player_transform.inversed());
+      player_transform *= transformFromStep(player_board, player_pos, dp);
+      player_faced_direction *= transformFromStep(player_board, player_pos, dp);
+      player_pos = pos;
+      player_board = board;
+    }
+  }
+}
+
+void createMote(BoardId board, vect2Di pos)
+{
+  // Square must be empty
+  if (!posIsEmpty(board, pos))
+  {
+    return;
+  }
+  entity_store.spawn(board, Entity::mote(pos));
+}
+
+void createPlant(BoardId board, vect2Di pos)
+{
+  // Square must be empty
+  if (!posIsWalkable(board, pos))
+  {
+    return;
+  }
+  board->setPlant(pos, PLANT_MAX_HEALTH);
+}
+
+void createPlant(Board& board, int cell)
+{
+  if (!cellIsWalkable(board, cell))
+  {
+    return;
+  }
+  board.setPlant(cell, PLANT_MAX_HEALTH);
+}
+
+void createWater(BoardId board, vect2Di pos, int depth)
+{
+  // Square must be empty
+  if (!posIsEmpty(board, pos))
+  {
+    return;
+  }
+  board->setWater(pos, depth);
+}
+
+// This assumes validity checks have been done, and just handles the bookkeeping
+void moveEntity(EntityId entity, BoardId new_board, vect2Di new_pos)
+{
+  BoardId old_board = entity_store.board(entity);
+
+  old_board->setEntity(old_board->entities.pos[entity_store.index(entity)], EntityId());
+  new_board->setEntity(new_pos, entity);
+
+  // if the entity has crossed over to a new board
+  if (new_board != old_board)
+  {
+    entity_store.transfer(entity, new_board);
+  }
+  new_board->entities.pos[entity_store.index(entity)] = new_pos;
+}
+
+vect2Di firstStepInDirection(vect2Di far_step)
+{
+  if (far_step == vect2Di(0, 0))
+  {
+    return far_step;
+  }
+  if (std::abs(far_step.x) > std::abs(far_step.y))
+  {
+    if (far_step.x > 0)
+    {
+      return RIGHT;
+    }
+    else
+    {
+      return LEFT;
+    }
+  }
+  else
+  {
+    if (far_step.y > 0)
+    {
+      return UP;
+    }
+    else
+    {
+      return DOWN;
+    }
+  }
+}
+
+// One coordinate of an orthogonalBresneham line.  Every step moves it goal/num_steps along, and pos is where that rounds to (halves away from zero),
+// kept up to date with an integer error term rather than by rounding a running double.
+struct BresenhamAxis
+{
+  int sign;
+  int length;
+  int num_steps;
+  // How far along the axis the rounded position is, so the coordinate is sign * pos
+  int pos = 0;
+  // 2 * num_steps * (exact distance along - (pos - 0.5)), which is in [0, 2 * num_steps) when pos is the rounded distance
+  int error;
+
+  BresenhamAxis(int goal, int num_steps)
+    : sign(goal < 0 ? -1 : 1),
+      length(std::abs(goal)),
+      num_steps(num_steps),
+      error(num_steps)
+  {
+  }
+
+  int coord()
+  {
+    return sign * pos;
+  }
+
+  // Takes the next step.  Returns true if it landed exactly halfway between two squares, which pos has rounded away from zero.
+  bool advance()
+  {
+    error += 2 * length;
+    if (error >= 2 * num_steps)
+    {
+      error -= 2 * num_steps;
+      pos++;
+    }
+    return error == 0;
+  }
+
+  // Round the half it just landed on toward zero instead
+  void roundHalfDown()
+  {
+    error += 2 * num_steps;
+    pos--;
+  }
+};
+
+// The line used to be stepped with a running double, and the exact ties (a coordinate landing on a half, or the line going right through a corner)
+// came out however its rounding errors said, not by any rule the integers could follow.  The shapes of sight lines and lasers are part of the game,
+// so the ties still go the way the double did.  This is that double, and nothing else about the line uses it.
+// It is only caught up to the current step when a tie comes up, so most lines never touch it.
+struct LegacyTies
+{
+  double step_x;
+  double step_y;
+  // The double after the steps so far, and the one before
+  double x = 0;
+  double y = 0;
+  double last_x = 0;
+  double last_y = 0;
+  int steps = 0;
+
+  LegacyTies(vect2Di goal, int num_steps)
+    : step_x(static_cast<double>(goal.x) / static_cast<double>(num_steps)),
+      step_y(static_cast<double>(goal.y) / static_cast<double>(num_steps))
+  {
+  }
+
+  // How far from zero the double rounded x (or y) to on step k
+  int roundedX(int k)
+  {
+    catchUp(k);
+    return std::abs(static_cast<int>(std::round(x)));
+  }
+  int roundedY(int k)
+  {
+    catchUp(k);
+    return std::abs(static_cast<int>(std::round(y)));
+  }
+
+  // Whether diagonal step k, right through a corner, went through the square to the side before the one above or below
+  bool horizontalFirst(int k)
+  {
+    catchUp(k);
+    double y_division = std::round(std::min(last_y, y)) + 0.5;
+    double x_division = std::round(std::min(last_x, x)) + 0.5;
+    double step_slope = (y - last_y)/(x - last_x);
+    double y_at_x_division = last_y + step_slope * (x_division - last_x);
+    return (y > last_y && y_at_x_division < y_division) || (y < last_y && y_at_x_division > y_division);
+  }
+
+private:
+  void catchUp(int k)
+  {
+    while (steps < k)
+    {
+      last_x = x;
+      last_y = y;
+      x += step_x;
+      y += step_y;
+      steps++;
+    }
+  }
+};
+
+// How many squares there are on the line orthogonalBresneham finds from (0, 0) to goal_pos
+int orthogonalBresnehamLength(vect2Di goal_pos)
+{
+  return std::abs(goal_pos.x) + std::abs(goal_pos.y) + 1;
+}
+
+// TODO: allow double start and end positions in order to allow slight perturbations to avoid needing to break ties.
+// This finds all the squares that fall on the line between (0, 0) and the given point the points are at the center of squares.  All squares on the line are orthogonally connected exactly once in a chain, with tie-breaking for diagonals.
+// They are written into squares, which needs room for orthogonalBresnehamLength(goal_pos) of them.
+void orthogonalBresneham(vect2Di goal_pos, vect2Di* squares)
+{
+  // this line starts at zero
+  // ties are broken towards y=+/-inf
+  const int num_steps = std::max(std::abs(goal_pos.x), std::abs(goal_pos.y));
+  BresenhamAxis x(goal_pos.x, num_steps);
+  BresenhamAxis y(goal_pos.y, num_steps);
+  LegacyTies ties(goal_pos, num_steps);
+  int count = 0;
+  squares[count++] = vect2Di(0, 0);
+  for (int step_num = 1; step_num <= num_steps; step_num++)
+  {
+    // every step will enter a new square.  The question is: was it a diagonal step?
+    int last_x = x.pos;
+    int last_y = y.pos;
+    if (x.advance() && ties.roundedX(step_num) != x.pos)
+    {
+      x.roundHalfDown();
+    }
+    if (y.advance() && ties.roundedY(step_num) != y.pos)
+    {
+      y.roundHalfDown();
+    }
+    // if diagonal step, there is another square before the next square
+    if (x.pos != last_x && y.pos != last_y)
+    {
+      // need to find which orthogonal square this went through.  Going by distances along the axes, it's horizontal first if the line
+      // gets to the next column (at last_x + 0.5) before the next row (at last_y + 0.5), so y.length * (last_x + 0.5) < x.length * (last_y + 0.5).
+      int64_t x_crossing = int64_t(y.length) * (2 * last_x + 1);
+      int64_t y_crossing = int64_t(x.length) * (2 * last_y + 1);
+      bool horizontal_first = x_crossing == y_crossing ? ties.horizontalFirst(step_num) : x_crossing < y_crossing;
+      if (horizontal_first)
+      {
+        squares[count++] = vect2Di(x.coord(), y.sign * last_y);
+      }
+      else
+      {
+        squares[count++] = vect2Di(x.sign * last_x, y.coord());
+      }
+    }
+    squares[count++] = vect2Di(x.coord(), y.coord());
+  }
+}
+
+// The same, but from start to end
+void orthogonalBresneham(vect2Di start, vect2Di end, vect2Di* squares)
+{
+  vect2Di rel_end = end-start;
+  orthogonalBresneham(rel_end, squares);
+  for (int i = 0; i < orthogonalBresnehamLength(rel_end); i++)
+  {
+    squares[i] += start;
+  }
+}
+
+std::vector<vect2Di> orthogonalBresneham(vect2Di goal_pos)
+{
+  std::vector<vect2Di> squares(orthogonalBresnehamLength(goal_pos));
+  orthogonalBresneham(goal_pos, squares.data());
+  return squares;
+}
+
+std::vector<vect2Di> orthogonalBresneham(vect2Di start, vect2Di end)
+{
+  std::vector<vect2Di> squares(orthogonalBresnehamLength(end-start));
+  orthogonalBresneham(start, end, squares.data());
+  return squares;
+}
+
+void makePortalPair(BoardId b1 ,vect2Di p1, BoardId b2, vect2Di p2, bool left=true)
+{
+  if (!b1->onBoard(p1) || !b2->onBoard(p2))
+    return;
+  // the step that crosses the seam going into p1 (or p2), and the square on the other side of it
+  vect2Di step = left ? LEFT : DOWN;
+  vect2Di back = -step;
+
+  b1->setPortal(p1, step, b2, p2+step);
+  b1->setPortal(p1+step, back, b2, p2);
+  b2->setPortal(p2, step, b1, p1+step);
+  b2->setPortal(p2+step, back, b1, p1);
+}
+
+void makeOneWayPortalPair( BoardId board1,vect2Di pos1, vect2Di step1, BoardId board2, vect2Di pos2, vect2Di step2, bool flip)
+{
+  // both squares must be on the board
+  if (!board1->onBoard(pos1) || !board2->onBoard(pos2))
+  {
+    return;
+  }
+  // The steps indicate direction and must be exactly one step orthogonal
+  if (abs(step1.x)+abs(step1.y) != 1 || abs(step2.x)+abs(step2.y) != 1)
+  {
+    return;
+  }
+
+  vect2Di v = step1;
+  Transform rotation1to2 = IDENTITY;
+  while(v != -step2)
+  {
+    v *= CCW;
+    rotation1to2 *= CCW;
+  }
+
+  // do all the logic for one portal at a time, just in case they are the same goddamn portal.
+  Transform transform1 = rotation1to2;
+
+  if (flip == true)
+  {
+    if (step1.x != 0)
+    {
+      transform1 *= FLIP_Y;
+    }
+    else
+    {
+      transform1 *= FLIP_X;
+    }
+  }
+  board1->setPortal(pos1, step1, board2, pos2, transform1);
+
+  Transform transform2 = rotation1to2.inversed();
+
+  if (flip == true)
+  {
+    if (step2.x != 0)
+    {
+      transform2 *= FLIP_Y;
+    }
+    else
+    {
+      transform2 *= FLIP_X;
+    }
+  }
+  board2->setPortal(pos2, step2, board1, pos1, transform2);
+}
+
+void makePortalPair2( BoardId board1, vect2Di pos1, vect2Di step1, BoardId board2, vect2Di pos2, vect2Di step2, bool flip=false)
+{
+  makeOneWayPortalPair( board1,pos1, step1, board2, pos2, step2, flip);
+  makeOneWayPortalPair( board1,pos1+step1, -step1, board2, pos2+step2, -step2, flip);
+}
+
+void makeNicePortalPair( BoardId b1,int x1, int y1, BoardId b2, int x2, int y2, int dx, int dy)
+{
+  b1->setWall(vect2Di(x1, y1), true);
+  b2->setWall(vect2Di(x2, y2), true);
+  b1->setWall(vect2Di(x1+dx, y1+dy), true);
+  b2->setWall(vect2Di(x2+dx, y2+dy), true);
+  int signx = dx>=0 ? 1 : -1;
+  int signy = dy>=0 ? 1 : -1;
+
+  for (int rx = 0; rx != dx; rx+=signx)
+  {
+    makePortalPair( b1,vect2Di(x1+rx,y1), b2,vect2Di(x2+rx,y2), false);
+  }
+
+  for (int ry = 0; ry != dy; ry+=signy)
+  {
+    makePortalPair( b1,vect2Di(x1+dx,y1+ry), b2,vect2Di(x2+dx,y2+ry), true);
+  }
+
+}
+
+void makeMirror(BoardId board, vect2Di square, vect2Di step)
+{
+  makePortalPair2( board,square, step, board, square, step, true);
+}
+
+void initWorld()
+{
+  // make the boards
+  std::vector<BoardId> board_ids;
+  for (int i = 0; i < 5; i++)
+  {
+    board_ids.push_back(addBoard(BOARD_SIZE));
+  }
+  player_board = board_ids[0];
+  player_pos = vect2Di(5, 5);
+
+
+  board_ids[0]->rectToWall(30, 5, 50, 20);
+
+  //rectToWall(20,10,22,12);
+  board_ids[0]->setWall(vect2Di(20,12), true);
+  board_ids[0]->setWall(vect2Di(20,10), true);
+  board_ids[0]->setWall(vect2Di(22,10), true);
+  makePortalPair2(board_ids[0] ,vect2Di(20, 11), RIGHT, board_ids[0], vect2Di(21, 10), UP, false);
+
+  // corner portal on frame of square
+  board_ids[0]->setWall(vect2Di(30,8), false);
+  board_ids[0]->setWall(vect2Di(30,7), false);
+  board_ids[0]->setWall(vect2Di(30,6), false);
+  board_ids[0]->setWall(vect2Di(33,5), false);
+  board_ids[0]->setWall(vect2Di(32,5), false);
+  board_ids[0]->setWall(vect2Di(31,5), false);
+  makePortalPair2( board_ids[0],vect2Di(31, 8), LEFT, board_ids[0], vect2Di(33, 6), DOWN, false);
+  makePortalPair2( board_ids[0],vect2Di(31, 7), LEFT, board_ids[0], vect2Di(32, 6), DOWN, false);
+  makePortalPair2( board_ids[0],vect2Di(31, 6), LEFT, board_ids[0], vect2Di(31, 6), DOWN, false);
+
+  //createMote(vect2Di(10, 20));
+  //createMote(vect2Di(10, 21));
+  //createMote(vect2Di(10, 22));
+  //createMote(vect2Di(11, 20));
+  //createMote(vect2Di(11, 21));
+
+  /*
+  board[45][13].wall = true;
+  board[20][13].wall = true;
+  makePortalPair(20,12,45,12);
+  makePortalPair(20,11,45,11);
+  makePortalPair(20,10,45,10);
+  makePortalPair(20,9,45,9);
+  board[45][8].wall = true;
+  board[20][8].wall = true;
+  */
+
+  //makePortalPair(vect2Di(10, 12), vect2Di(20, 12));
+  //makePortalPair(vect2Di(10, 11), vect2Di(20, 11));
+  //makePortalPair(vect2Di(10, 10), vect2Di(20, 10));
+
+  // This should be a mirror
+  makeMirror(board_ids[0], vect2Di(1,9), LEFT);
+  makeMirror(board_ids[0], vect2Di(1,8), LEFT);
+  makeMirror(board_ids[0], vect2Di(1,7), LEFT);
+  makeMirror(board_ids[0], vect2Di(1,6), LEFT);
+
+  // this should be a retro-reflector
+  makePortalPair2(board_ids[0], vect2Di(1, 4), LEFT, board_ids[0], vect2Di(1, 4), LEFT, false);
+
+  // the infinite tunnel
+  makeNicePortalPair(board_ids[0], 20, 20, board_ids[0], 20, 30, 7, 0);
+
+
+  // Make links to the other 3 boards in the top left corner of the first board
+  // to the second board from first
+  makeNicePortalPair(board_ids[0], 8, BOARD_SIZE - 7, board_ids[1], 8, 6, 8, 0);
+  // third from second
+  makeNicePortalPair(board_ids[1], 6, 8, board_ids[2], BOARD_SIZE - 7, 8, 0, 8);
+  // fourth from third
+  makeNicePortalPair(board_ids[2], BOARD_SIZE - 9, 6, board_ids[3], BOARD_SIZE - 9, BOARD_SIZE - 7, -8, 0);
+  // fourth from first
+  makeNicePortalPair(board_ids[0], 6, BOARD_SIZE - 9, board_ids[3], BOARD_SIZE - 7, BOARD_SIZE - 9, 0, -8);
+  // third from first
+  makeNicePortalPair(board_ids[0], 8, BOARD_SIZE - 11 - 8, board_ids[2], BOARD_SIZE - 9 - 8, 10 + 8 , 8, 0);
+
+  // fill in the center of the ostensible cross in the middle of the numbers
+  board_ids[0]->setWall(vect2Di(7, BOARD_SIZE-7), true);
+  board_ids[0]->setWall(vect2Di(6, BOARD_SIZE-7), true);
+  board_ids[0]->setWall(vect2Di(6, BOARD_SIZE-8), true);
+
+  board_ids[1]->setWall(vect2Di(7, 6), true);
+  board_ids[1]->setWall(vect2Di(6, 6), true);
+  board_ids[1]->setWall(vect2Di(6, 7), true);
+
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-8, 6), true);
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-7, 6), true);
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-7, 7), true);
+
+  board_ids[3]->setWall(vect2Di(BOARD_SIZE-8, BOARD_SIZE-7), true);
+  board_ids[3]->setWall(vect2Di(BOARD_SIZE-7, BOARD_SIZE-7), true);
+  board_ids[3]->setWall(vect2Di(BOARD_SIZE-7, BOARD_SIZE-8), true);
+
+  board_ids[0]->setWall(vect2Di(7, BOARD_SIZE-11-8), true);
+  board_ids[0]->setWall(vect2Di(6, BOARD_SIZE-11-8), true);
+  board_ids[0]->setWall(vect2Di(6, BOARD_SIZE-10-8), true);
+
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-8, 18), true);
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-7, 18), true);
+  board_ids[2]->setWall(vect2Di(BOARD_SIZE-7, 17), true);
+
+  // draw a mirror on the third board
+  for (int i=5; i <=15; i++)
+  {
+    makeMirror(board_ids[2], vect2Di(BOARD_SIZE - 20, i), LEFT);
+  }
+  // Draw numbers out of walls to show which board is which
+  // 1
+  int x = 11;
+  int y = BOARD_SIZE - 11;
+  //board_ids[0]->setWall(vect2Di(x+0, y-0), true);
+  board_ids[0]->setWall(vect2Di(x+1, y-0), true);
+  //board_ids[0]->setWall(vect2Di(x+2, y-0), true);
+  board_ids[0]->setWall(vect2Di(x+0, y-1), true);
+  board_ids[0]->setWall(vect2Di(x+1, y-1), true);
+  //board_ids[0]->setWall(vect2Di(x+2, y-1), true);
+  //board_ids[0]->setWall(vect2Di(x+0, y-2), true);
+  board_ids[0]->setWall(vect2Di(x+1, y-2), true);
+  //board_ids[0]->setWall(vect2Di(x+2, y-2), true);
+  //board_ids[0]->setWall(vect2Di(x+0, y-3), true);
+  board_ids[0]->setWall(vect2Di(x+1, y-3), true);
+  //board_ids[0]->setWall(vect2Di(x+2, y-3), true);
+  board_ids[0]->setWall(vect2Di(x+0, y-4), true);
+  board_ids[0]->setWall(vect2Di(x+1, y-4), true);
+  board_ids[0]->setWall(vect2Di(x+2, y-4), true);
+
+  // 2
+  x = 11;
+  y = 14;
+  board_ids[1]->setWall(vect2Di(x+0, y-0), true);
+  board_ids[1]->setWall(vect2Di(x+1, y-0), true);
+  board_ids[1]->setWall(vect2Di(x+2, y-0), true);
+  //board_ids[1]->setWall(vect2Di(x+0, y-1), true);
+  //board_ids[1]->setWall(vect2Di(x+1, y-1), true);
+  board_ids[1]->setWall(vect2Di(x+2, y-1), true);
+  board_ids[1]->setWall(vect2Di(x+0, y-2), true);
+  board_ids[1]->setWall(vect2Di(x+1, y-2), true);
+  board_ids[1]->setWall(vect2Di(x+2, y-2), true);
+  board_ids[1]->setWall(vect2Di(x+0, y-3), true);
+  //board_ids[1]->setWall(vect2Di(x+1, y-3), true);
+  //board_ids[1]->setWall(vect2Di(x+2, y-3), true);
+  board_ids[1]->setWall(vect2Di(x+0, y-4), true);
+  board_ids[1]->setWall(vect2Di(x+1, y-4), true);
+  board_ids[1]->setWall(vect2Di(x+2, y-4), true);
+
+  // 3
+  x = BOARD_SIZE - 14;
+  y = 14;
+  board_ids[2]->setWall(vect2Di(x+0, y-0), true);
+  board_ids[2]->setWall(vect2Di(x+1, y-0), true);
+  board_ids[2]->setWall(vect2Di(x+2, y-0), true);
+  //board_ids[2]->setWall(vect2Di(x+0, y-1), true);
+  //board_ids[2]->setWall(vect2Di(x+1, y-1), true);
+  board_ids[2]->setWall(vect2Di(x+2, y-1), true);
+  board_ids[2]->setWall(vect2Di(x+0, y-2), true);
+  board_ids[2]->setWall(vect2Di(x+1, y-2), true);
+  board_ids[2]->setWall(vect2Di(x+2, y-2), true);
+  //board_ids[2]->setWall(vect2Di(x+0, y-3), true);
+  //board_ids[2]->setWall(vect2Di(x+1, y-3), true);
+  board_ids[2]->setWall(vect2Di(x+2, y-3), true);
+  board_ids[2]->setWall(vect2Di(x+0, y-4), true);
+  board_ids[2]->setWall(vect2Di(x+1, y-4), true);
+  board_ids[2]->setWall(vect2Di(x+2, y-4), true);
+
+  //4
+  x = BOARD_SIZE - 14;
+  y = BOARD_SIZE - 11;
+  board_ids[3]->setWall(vect2Di(x+0, y-0), true);
+  //board_ids[3]->setWall(vect2Di(x+1, y-0), true);
+  board_ids[3]->setWall(vect2Di(x+2, y-0), true);
+  board_ids[3]->setWall(vect2Di(x+0, y-1), true);
+  //board_ids[3]->setWall(vect2Di(x+1, y-1), true);
+  board_ids[3]->setWall(vect2Di(x+2, y-1), true);
+  board_ids[3]->setWall(vect2Di(x+0, y-2), true);
+  board_ids[3]->setWall(vect2Di(x+1, y-2), true);
+  board_ids[3]->setWall(vect2Di(x+2, y-2), true);
+  //board_ids[3]->setWall(vect2Di(x+0, y-3), true);
+  //board_ids[3]->setWall(vect2Di(x+1, y-3), true);
+  board_ids[3]->setWall(vect2Di(x+2, y-3), true);
+  //board_ids[3]->setWall(vect2Di(x+0, y-4), true);
+  //board_ids[3]->setWall(vect2Di(x+1, y-4), true);
+  board_ids[3]->setWall(vect2Di(x+2, y-4), true);
+
+
+  makeNicePortalPair(board_ids[0], 60, 20, board_ids[0], 72, 20, 5, 0);
+  for (int y = 10; y < 31; y++)
+  {
+    board_ids[0]->setWall(vect2Di(60, y), true);
+    board_ids[0]->setWall(vect2Di(66, y), true);
+    board_ids[0]->setWall(vect2Di(72, y), true);
+    board_ids[0]->setWall(vect2Di(78, y), true);
+  }
+
+  createPlant(board_ids[0], vect2Di(10, 40));
+  createPlant(board_ids[0], vect2Di(10, 41));
+  createPlant(board_ids[0], vect2Di(11, 41));
+
+  createWater(board_ids[0], vect2Di(10, 15), 300);
+}
+
+// A level far bigger than the test map, for seeing how the world copes with lots of room: num_boards boards of width by height,
+// each one a room with a few walls, a plant, a pool, and a mote scattered about, and a doorway on its right that leads into the next.
+// Most of every board is open floor, which the boards don't store (see ChunkedPlane).
+void initSprawlWorld(int num_boards, int width, int height)
+{
+  num_boards = std::min(std::max(num_boards, 1), MAX_BOARDS);
+  // room for the doorways
+  width = std::min(std::max(width, 16), MAX_BOARD_SIDE);
+  height = std::min(std::max(height, 16), MAX_BOARD_SIDE);
+  std::vector<BoardId> board_ids;
+  for (int i = 0; i < num_boards; i++)
+  {
+    board_ids.push_back(addBoard(width, height));
+  }
+  player_board = board_ids[0];
+  player_pos = vect2Di(width/2, height/2);
+
+  const int DOOR_SIZE = 6;
+  int door_y = height/2 - DOOR_SIZE/2;
+  for (int i = 0; i < num_boards; i++)
+  {
+    BoardId board = board_ids[i];
+    for (int r = 0; r < 4; r++)
+    {
+      int left = random(2, width - 12);
+      int bottom = random(2, height - 12);
+      board->rectToWall(left, bottom, left + random(2, 10), bottom + random(2, 10));
+    }
+    // keep the way through clear
+    for (int x = 1; x < width - 1; x++)
+    {
+      for (int y = door_y - 1; y < door_y + DOOR_SIZE + 1; y++)
+      {
+        board->setWall(vect2Di(x, y), false);
+      }
+    }
+    createPlant(board, vect2Di(random(2, width - 2), random(2, height - 2)));
+    createWater(board, vect2Di(random(2, width - 2), random(2, height - 2)), 100);
+    if (i > 0)
+    {
+      createMote(board, vect2Di(random(2, width - 2), random(2, height - 2)));
+    }
+  }
+  for (int i = 0; i + 1 < num_boards; i++)
+  {
+    makeNicePortalPair(board_ids[i], width - 4, door_y, board_ids[i + 1], 4, door_y, 0, DOOR_SIZE);
+  }
+}
+
+// x is in squares to the right
+// t is in turns
+// phase is scaled to full circle at 1
+double laserShape(double x, double t, double phase)
+{
+  const double WAVELENGTH = 5;
+  const double PERIOD = 5;
+  const double GROWTH_SCALE = 0.01;
+  const double GROWTH_MAX = 2;
+  const double DISTANCE_SCALE = 0.2;
+  return std::sin(x/WAVELENGTH - t/PERIOD + phase*2*M_PI) * x*DISTANCE_SCALE * std::min(std::exp(t*GROWTH_SCALE)-1, GROWTH_MAX);
+}
+
+// Appends the laser's shape to laser_squares, starting from ZERO and going right
+void naiveLaserSquares(std::vector<vect2Di>& laser_squares, int t, double phase)
+{
+  const int LASER_RANGE = sight_radius * 2;
+  vect2Di prev_laser_point = ZERO;
+  laser_squares.push_back(prev_laser_point);
+  for (int x = 1; x <= LASER_RANGE; x+=3)
+  {
+    vect2Di laser_point = vect2Di(x, std::round(laserShape(x, t, phase)));
+    // append the new squares, writing the first one over the last square of the previous piece, which is the same square
+    int first = static_cast<int>(laser_squares.size()) - 1;
+    laser_squares.resize(first + orthogonalBresnehamLength(laser_point - prev_laser_point));
+    orthogonalBresneham(prev_laser_point, laser_point, &laser_squares[first]);
+    prev_laser_point = laser_point;
+  }
+}
+
+const int LASER_STREAMS = 5;
+// How many turns of laser paths are kept.  A laser held for longer works out the rest every turn.
+const int LASER_TABLE_TURNS = 256;
+
+// The naive shapes of the laser's streams, going right, a turn's worth of streams after another, like a RayTable.
+// Path t * LASER_STREAMS + p, stream p of the table's turn t, is squares[starts[path]] up to but not including squares[starts[path+1]].
+struct LaserPathTable
+{
+  int radius = -1;
+  std::vector<vect2Di> squares;
+  std::vector<int> starts;
+  // How many naive squares each path starts with that are the same as the stream before it (0 for stream 0), for curveCastBatch
+  std::vector<int> shared;
+
+  int numTurns()
+  {
+    return static_cast<int>(shared.size()) / LASER_STREAMS;
+  }
+
+  // Keeps the storage
+  void clear()
+  {
+    radius = sight_radius;
+    squares.clear();
+    starts.assign(1, 0);
+    shared.clear();
+  }
+
+  // Works out the streams of the laser's turn t, after the turns already in the table
+  void addTurn(int t)
+  {
+    for (int p = 0; p < LASER_STREAMS; p++)
+    {
+      int start = static_cast<int>(squares.size());
+      double phase = static_cast<double>(p)/static_cast<double>(LASER_STREAMS+25);
+      naiveLaserSquares(squares, t, phase);
+      int same = 0;
+      if (p > 0)
+      {
+        int prev_start = starts[starts.size() - 2];
+        int length = std::min(start - prev_start, static_cast<int>(squares.size()) - start);
+        while (same < length && squares[prev_start + same] == squares[start + same])
+        {
+          same++;
+        }
+      }
+      shared.push_back(same);
+      starts.push_back(squares.size());
+    }
+  }
+};
+
+// The laser's shape only depends on how long it has been held, so each turn's is worked out once, up to LASER_TABLE_TURNS.
+// Returns the table with turn t's streams in it, and sets first_path to where they are in it.
+LaserPathTable& laserPathTable(int t, int& first_path)
+{
+  static LaserPathTable table;
+  // for turns past the end of table, just the one turn
+  static LaserPathTable late_turn;
+  if (table.radius != sight_radius)
+  {
+    table.clear();
+  }
+  if (t < LASER_TABLE_TURNS)
+  {
+    while (table.numTurns() <= t)
+    {
+      table.addTurn(table.numTurns());
+    }
+    first_path = t * LASER_STREAMS;
+    return table;
+  }
+  late_turn.clear();
+  late_turn.addTurn(t);
+  first_path = 0;
+  return late_turn;
+}
+
+void createArrow(BoardId board, vect2Di world_pos, vect2Di direction)
+{
+  // Square must be empty
+  if (!posIsFlyable(board, world_pos))
+  {
+    return;
+  }
+  entity_store.spawn(board, Entity::arrow(world_pos, direction));
+}
+
+void createTurret(BoardId board, vect2Di world_pos, vect2Di direction)
+{
+  // Square must be empty
+  if (!posIsWalkable(board, world_pos))
+  {
+    return;
+  }
+  entity_store.spawn(board, Entity::turret(world_pos, direction));
+}
+
+// attempt to spawn an arrow just in front of the player
+void shootArrow()
+{
+  // first need to find the square and direction that is directly in front of the player
+  vect2Di step = player_faced_direction;
+  Line& step_line = lineCast(player_board, player_pos, step);
+  if (!step_line.empty())
+  {
+    vect2Di newpos = step_line[0].board_pos;
+    BoardId newboard = step_line[0].board;
+    if (posIsFlyable(newboard, newpos))
+    {
+      Transform T = transformFromStep(player_board, player_pos, step);
+      createArrow(player_board, newpos, player_faced_direction * T);
+    }
+  }
+}
+
+// attempt to spawn a turret just in front of the player
+void buildTurret()
+{
+  // first need to find the square and direction that is directly in front of the player
+  vect2Di step = player_faced_direction;
+  Line& step_line = lineCast(player_board, player_pos, step);
+  if (!step_line.empty())
+  {
+    vect2Di newpos = step_line[0].board_pos;
+    BoardId newboard = step_line[0].board;
+    if (posIsWalkable(newboard, newpos))
+    {
+      Transform T = transformFromStep(player_board, player_pos, step);
+      createTurret(newboard, newpos, player_faced_direction * T);
+    }
+  }
+}
+
+// make the laser beams, kill motes, and mark squares as laser
+void shootLaser()
+{
+  int t = consecutive_laser_rounds;
+  Transform rot_to_player_faced;
+  for (int i = 0; i < player_faced_direction.ccwRotations(); i++)
+  {
+    rot_to_player_faced *= CCW;
+  }
+  int first_path;
+  LaserPathTable& paths = laserPathTable(t, first_path);
+  // the streams are cast before any of them burns anything, which is fine as nothing they burn changes where a line goes
+  Line* laser_lines[LASER_STREAMS];
+  curveCastBatch(laser_lines, LASER_STREAMS, player_board, player_pos, rot_to_player_faced,
+                 paths.squares.data(), &paths.starts[first_path], &paths.shared[first_path]);
+  for (int p = 0; p < LASER_STREAMS; p++)
+  {
+    const Line& laser_line = *laser_lines[p];
+    // for every square of the laser
+    for (SquareMap mapping : laser_line)
+    {
+      BoardId board = mapping.board;
+      vect2Di pos = mapping.board_pos;
+      // Lasers don't go through walls
+      if (board->getWall(pos) == true)
+      {
+        break;
+      }
+      board->setFire(pos, true);
+      EntityId hit_entity = board->getEntity(pos);
+      if (hit_entity.valid())
+      {
+        entity_store.despawn(hit_entity);
+      }
+      if (board->getPlant(pos) > 0)
+      {
+        board->setPlant(pos, board->getPlant(pos) - 1);
+        // plants stop lasers
+        break;
+      }
+    }
+  }
+}
+
+// The way to the player from every square within PURSUIT_RANGE steps of them, through portals and around walls and plants, found breadth first.
+// Boards keep the step to take from each square in toward_player, so any number of motes follow it for one lookup each.
+// Like the sight cache, it is kept from turn to turn, and only found again when the player moves,
+// or the walls, plants, or portals change on a square it looked at.  Entities don't count, they move out of the way.
+struct PursuitField
+{
+  bool valid = false;
+  BoardId board;
+  vect2Di pos;
+  // The boards the field has looked at squares of, and the ones it had before it was found again
+  std::vector<BoardId> boards;
+  std::vector<BoardId> old_boards;
+  // The squares at the current and next distance out, kept for their storage
+  std::vector<std::pair<Board*, int>> frontier;
+  std::vector<std::pair<Board*, int>> next_frontier;
+};
+PursuitField pursuit_field;
+
+// Has anything the field looked at changed where you can go?
+bool pursuitChanged()
+{
+  for (BoardId board : pursuit_field.boards)
+  {
+    for (uint64_t word : board->pursuit_dirty.words)
+    {
+      if (word != 0)
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Make sure the field has the board in its list, and somewhere to put the board's steps
+void addPursuitBoard(BoardId board)
+{
+  PursuitField& field = pursuit_field;
+  if (std::find(field.boards.begin(), field.boards.end(), board) != field.boards.end())
+  {
+    return;
+  }
+  field.boards.push_back(board);
+  if (board->toward_player.empty())
+  {
+    board->toward_player.resize(board->numCells(), NO_PURSUIT);
+  }
+}
+
+// Find the field again if it is out of date
+void updatePursuitField()
+{
+  PursuitField& field = pursuit_field;
+  if (field.valid && field.board == player_board && field.pos == player_pos && !pursuitChanged())
+  {
+    return;
+  }
+  // toward_player is only read where in_pursuit is set, so that is all that needs clearing
+  for (BoardId board : field.boards)
+  {
+    std::fill(board->in_pursuit.words.begin(), board->in_pursuit.words.end(), 0);
+    std::fill(board->pursuit_dirty.words.begin(), board->pursuit_dirty.words.end(), 0);
+  }
+  std::swap(field.boards, field.old_boards);
+  field.boards.clear();
+  field.valid = true;
+  field.board = player_board;
+  field.pos = player_pos;
+
+  addPursuitBoard(player_board);
+  int player_cell = player_board->cellIndex(player_pos);
+  player_board->in_pursuit.set(player_cell, true);
+  player_board->toward_player.set(player_cell, NO_PURSUIT);
+  field.frontier.assign(1, std::make_pair(&*player_board, player_cell));
+  for (int distance = 1; distance <= PURSUIT_RANGE && !field.frontier.empty(); distance++)
+  {
+    field.next_frontier.clear();
+    for (std::pair<Board*, int>& square : field.frontier)
+    {
+      Board& board = *square.first;
+      for (int dir = 0; dir < 4; dir++)
+      {
+        Board* next_board;
+        int cell;
+        if (!stepCell(board, square.second, dir, next_board, cell))
+        {
+          continue;
+        }
+        // the step back, from the next square toward the player
+        int back = (dir + 2) % 4;
+        // the only unusual steps that don't go off the board go through portals
+        if (board.unusual_steps.get(square.second, dir))
+        {
+          // Portals come in pairs, so going back the way the step arrived leads to where it came from
+          back = directionIndex(-(ORTHOGONALS[dir] * Transform(board.step(square.second, dir).transform)));
+          addPursuitBoard(next_board->id);
+        }
+        Board& next = *next_board;
+        if (next.in_pursuit.get(cell))
+        {
+          continue;
+        }
+        next.in_pursuit.set(cell, true);
+        // Blocked squares are marked too, since one opening up would change the field
+        if (next.getWall(cell) || next.getPlant(cell) != 0)
+        {
+          next.toward_player.set(cell, NO_PURSUIT);
+          continue;
+        }
+        next.toward_player.at(cell) = back;
+        field.next_frontier.push_back(std::make_pair(next_board, cell));
+      }
+    }
+    std::swap(field.frontier, field.next_frontier);
+  }
+
+  // The boards the field has left don't need their steps any more
+  for (BoardId board : field.old_boards)
+  {
+    if (std::find(field.boards.begin(), field.boards.end(), board) == field.boards.end())
+    {
+      board->toward_player.clear();
+    }
+  }
+}
+
+// Face entity k a step closer to the player along the pursuit field.  Returns false if the field doesn't reach it.
+bool followPursuit(BoardId board, EntityArrays& entities, int k)
+{
+  int cell = board->cellIndex(entities.pos[k]);
+  if (!board->in_pursuit.get(cell) || board->toward_player.get(cell) == NO_PURSUIT)
+  {
+    return false;
+  }
+  entities.faced_direction[k] = ORTHOGONALS[board->toward_player.get(cell)];
+  return true;
+}
+
+// if entity k knows where the player is, face the player
+void facePlayer(EntityArrays& entities, int k, Rng& rng)
+{
+  vect2Di dir = entities.rel_player_pos[k];
+  if (dir != ZERO)
+  {
+    vect2Di newfaced;
+    // if along x axis
+    if (std::abs(dir.x) > std::abs(dir.y) || (std::abs(dir.x) == std::abs(dir.y) && rng.range(0, 2) == 0)) // tiebreak random because why not
+    {
+      if (dir.x > 0)
+      {
+        newfaced = RIGHT;
+      }
+      else
+      {
+        newfaced = LEFT;
+      }
+    }
+    else
+    {
+      if (dir.y > 0)
+      {
+        newfaced = UP;
+      }
+      else
+      {
+        newfaced = DOWN;
+      }
+    }
+    entities.faced_direction[k] = newfaced;
+  }
+}
+
+void updateEntities()
+{
+  std::vector<EntityId> todelete;
+  if (pursuit_mode == PURSUIT_FIELD)
+  {
+    updatePursuitField();
+  }
+  for (int b = 0; b < static_cast<int>(boards.size()); b++)
+  {
+    BoardId board(b);
+    EntityArrays& entities = board->entities;
+    Rng rng = tickRng(RNG_ENTITIES, b);
+    int k = 0;
+    while (k < entities.size())
+    {
+      EntityId id = entities.id[k];
+      uint8_t flags = entities.flags[k];
+      // face the player if can turn
+      if (flags & ENTITY_HOMING)
+      {
+        if (pursuit_mode != PURSUIT_FIELD || !followPursuit(board, entities, k))
+        {
+          facePlayer(entities, k, rng);
+        }
+      }
+      if (flags & ENTITY_MOVING)
+      {
+        vect2Di pos = entities.pos[k];
+        vect2Di step = entities.faced_direction[k];
+        vect2Di newpos;
+        BoardId newboard;
+        Transform T;
+        orthogonalRedirect(board, pos, step, newboard, newpos, T);
+        if (posIsFlyable(newboard, newpos))
+        {
+          entities.faced_direction[k] *= T;
+          if (entities.rel_player_pos[k] != ZERO)
+          {
+            entities.rel_player_pos[k] -= step;
+            entities.rel_player_pos[k] *= T;
+          }
+          moveEntity(id, newboard, newpos);
+        }
+        // if the new position is not clear, the arrow dies, and maybe does some damage
+        else if (flags & ENTITY_DIE_ON_TOUCH)
+        {
+          if (newboard->getPlant(newpos) > 0)
+          {
+            newboard->setPlant(newpos, newboard->getPlant(newpos) - 1);
+          }
+          else if (newboard->getWall(newpos) == true)
+          {
+            // can't damage a wall with a simple arrow
+          }
+          else if (newboard->hasEntity(newpos))
+          {
+            todelete.push_back(newboard->getEntity(newpos));
+          }
+          // no mater what the arrow has hit, the arrow dies
+          todelete.push_back(id);
+        }
+
+      }
+      if (flags & ENTITY_CAN_SHOOT)
+      {
+        // it may have moved to another board
+        BoardId shooter_board = entity_store.board(id);
+        EntityArrays& shooter = shooter_board->entities;
+        int s = entity_store.index(id);
+        if (shooter.cooldown[s] > 0)
+        {
+          shooter.cooldown[s] -= 1;
+        }
+        else
+        {
+          // raycast ahead of the entity, and if it sees another entity, shoot it and set the cooldown
+          vect2Di step = shooter.faced_direction[s] * TURRET_DETECTION_RANGE;
+          Line& detection_line = lineCast(shooter_board, shooter.pos[s], step);
+          for (SquareMap mapping : detection_line)
+          {
+            if (mapping.board->getWall(mapping.board_pos) == true)
+            {
+              break;
+            }
+            else if (mapping.board->hasEntity(mapping.board_pos) || mapping.board_pos == player_pos)
+            {
+              // if there is space in front of the entity
+              SquareMap first = detection_line[0];
+              if (posIsFlyable(first.board, first.board_pos))
+              {
+                // shoot an arrow
+                Transform T = transformFromStep(shooter_board, shooter.pos[s], shooter.faced_direction[s]);
+                createArrow(first.board, first.board_pos, shooter.faced_direction[s] * T);
+                // the new arrow may have grown the arrays, but it doesn't move anything already in them
+                shooter.cooldown[s] = TURRET_MAX_COOLDOWN;
+                break;
+              }
+            }
+          }
+        }
+      }
+      // an entity that left the board has had the last one moved into its place, which still needs its turn
+      if (entity_store.board(id) == board)
+      {
+        k++;
+      }
+    }
+  }
+  // an entity can be hit twice, so some of these may already be gone
+  for (EntityId id : todelete)
+  {
+    entity_store.despawn(id);
+  }
+}
+
+// The naive (portal-free) shapes of all the player's sight lines for one radius, relative to the player, in draw order.
+// Sight line r is squares[starts[r]] up to but not including squares[starts[r+1]], starting with the player's own square.
+struct RayTable
+{
+  int radius = -1;
+  std::vector<vect2Di> squares;
+  std::vector<int> starts;
+
+  int numRays()
+  {
+    return static_cast<int>(starts.size()) - 1;
+  }
+};
+
+RayTable buildRayTable(int radius)
+{
+  // the order these are updated is essentially bottom to top in terms of draw order
+
+  std::vector<vect2Di> rel_p;
+
+  // The orthogonals
+
+  rel_p.push_back(vect2Di(radius, 0));
+
+  rel_p.push_back(vect2Di(0, radius));
+
+  rel_p.push_back(vect2Di(-radius, 0));
+
+  rel_p.push_back(vect2Di(0, -radius));
+
+  // All the non-diagonals and non-orthogonals, moving from diagonal to orthogonal
+  for(int i = 1; i < radius; i++)
+  {
+    // all 8 octants
+    rel_p.push_back(vect2Di(radius, i));
+    rel_p.push_back(vect2Di(i, radius));
+    rel_p.push_back(vect2Di(-i, radius));
+    rel_p.push_back(vect2Di(-radius, i));
+    rel_p.push_back(vect2Di(-radius, -i));
+    rel_p.push_back(vect2Di(-i, -radius));
+    rel_p.push_back(vect2Di(i, -radius));
+    rel_p.push_back(vect2Di(radius, -i));
+  }
+  // The diagonals
+  rel_p.push_back(vect2Di(radius, radius));
+  rel_p.push_back(vect2Di(-radius, radius));
+  rel_p.push_back(vect2Di(radius, -radius));
+  rel_p.push_back(vect2Di(-radius, -radius));
+
+  RayTable table;
+  table.radius = radius;
+  for (vect2Di end : rel_p)
+  {
+    int start = static_cast<int>(table.squares.size());
+    table.starts.push_back(start);
+    table.squares.resize(start + orthogonalBresnehamLength(end));
+    orthogonalBresneham(end, &table.squares[start]);
+  }
+  table.starts.push_back(table.squares.size());
+  return table;
+}
+
+// The ray shapes never change, so they are only worked out again when the sight radius does
+RayTable& sightRayTable()
+{
+  static RayTable table;
+  if (table.radius != sight_radius)
+  {
+    table = buildRayTable(sight_radius);
+  }
+  return table;
+}
+
+void castSightRay(int i)
+{
+  RayTable& table = sightRayTable();
+  bool is_sight_line = true;
+  int start = table.starts[i];
+  curveCast(player_sight_lines[i], player_board, player_pos, &table.squares[start], table.starts[i+1] - start, is_sight_line);
+}
+
+// Work out all of the player's sight from scratch
+void castSightLines()
+{
+  if (sight_mode == SIGHT_SHADOWCAST)
+  {
+    shadowcastSight();
+    return;
+  }
+
+  RayTable& table = sightRayTable();
+
+  // Lines are reused from the last turn so their storage is too
+  player_sight_lines.resize(table.numRays());
+  // Find the sight lines in this order
+  for(int i = 0; i < table.numRays(); i++)
+  {
+    castSightRay(i);
+  }
+}
+
+// The player's sight is kept from turn to turn, and only cast again when something it depends on changes:
+// the player moving (through a portal or not), or sight blocking or portals changing on a square it reached.
+// Boards note those changes themselves, for the squares marked in_sight.
+// Sight rays only depend on the squares they reach, so only the rays through a changed square are cast again.
+// Shadowcasting shares its work between octants, so it is all cast again.
+struct SightCache
+{
+  bool valid = false;
+  BoardId board;
+  vect2Di pos;
+  int radius = -1;
+  SightMode mode = SIGHT_RAYS;
+  // Every square marked in_sight, to unmark them when the sight changes
+  std::vector<std::pair<BoardId, int>> seen;
+  // The boards with squares in sight, and the ones that had some before the sight changed
+  std::vector<BoardId> boards;
+  std::vector<BoardId> old_boards;
+};
+SightCache sight_cache;
+
+// Cast everything again next time, for when the world is swapped out from under the cache
+void invalidateSight()
+{
+  sight_cache.valid = false;
+}
+
+// Unmark the squares that were in sight, and mark the ones in the current sight lines instead
+void updateSeenSquares()
+{
+  SightCache& cache = sight_cache;
+  for (std::pair<BoardId, int>& square : cache.seen)
+  {
+    square.first->in_sight.set(square.second, false);
+  }
+  cache.seen.clear();
+  std::swap(cache.boards, cache.old_boards);
+  cache.boards.clear();
+
+  for (Line& line : player_sight_lines)
+  {
+    for (int s = 0; s < static_cast<int>(line.segments.size()); s++)
+    {
+      Board& board = *line.segments[s].board;
+      if (std::find(cache.boards.begin(), cache.boards.end(), board.id) == cache.boards.end())
+      {
+        cache.boards.push_back(board.id);
+        if (board.seen_at.empty())
+        {
+          board.seen_at.resize(board.numCells(), ZERO);
+        }
+      }
+      for (int i = line.segments[s].first; i < line.segmentEnd(s); i++)
+      {
+        int cell = board.cellIndex(line.squares[i].boardPos());
+        // later sight lines draw over earlier ones, so they decide where a square is seen
+        board.seen_at.at(cell) = line.squares[i].linePos();
+        if (!board.in_sight.get(cell))
+        {
+          board.in_sight.set(cell, true);
+          cache.seen.push_back(std::make_pair(board.id, cell));
+        }
+      }
+    }
+  }
+
+  // Every sight line leaves from the player's square, so its portals matter too
+  cache.board = player_board;
+  cache.pos = player_pos;
+  int player_cell = player_board->cellIndex(player_pos);
+  if (!player_board->in_sight.get(player_cell))
+  {
+    player_board->in_sight.set(player_cell, true);
+    cache.seen.push_back(std::make_pair(player_board, player_cell));
+  }
+
+  // The boards that went out of sight don't need to know where they were seen from
+  for (BoardId board : cache.old_boards)
+  {
+    if (std::find(cache.boards.begin(), cache.boards.end(), board) == cache.boards.end())
+    {
+      board->seen_at.clear();
+    }
+  }
+}
+
+// If an entity is in sight, it knows where the player is relative to itself
+void aimSeenEntities()
+{
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    EntityArrays& entities = board->entities;
+    for (int k = 0; k < entities.size(); k++)
+    {
+      int cell = board->cellIndex(entities.pos[k]);
+      // the player's own square is marked too, but nothing else can be there
+      if (board->in_sight.get(cell) && !(board->id == player_board && entities.pos[k] == player_pos))
+      {
+        entities.rel_player_pos[k] = -board->seen_at.get(cell);
+      }
+    }
+  }
+}
+
+// Does the line go through a square whose sight blocking or portals have changed?
+bool reachesSightChange(const Line& line)
+{
+  for (int s = 0; s < static_cast<int>(line.segments.size()); s++)
+  {
+    Board& board = *line.segments[s].board;
+    for (int i = line.segments[s].first; i < line.segmentEnd(s); i++)
+    {
+      if (board.sight_dirty.get(board.cellIndex(line.squares[i].boardPos())))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void updateSightLines()
+{
+  SightCache& cache = sight_cache;
+  bool moved = !cache.valid ||
+               cache.board != player_board ||
+               cache.pos != player_pos ||
+               cache.radius != sight_radius ||
+               cache.mode != sight_mode;
+
+  bool changed = false;
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    if (!board->sightChanges().empty())
+    {
+      changed = true;
+    }
+  }
+
+  if (moved || (changed && (sight_mode == SIGHT_SHADOWCAST || player_board->sight_dirty.get(player_board->cellIndex(player_pos)))))
+  {
+    castSightLines();
+    updateSeenSquares();
+  }
+  else if (changed)
+  {
+    for (int i = 0; i < static_cast<int>(player_sight_lines.size()); i++)
+    {
+      if (reachesSightChange(player_sight_lines[i]))
+      {
+        castSightRay(i);
+      }
+    }
+    updateSeenSquares();
+  }
+
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    for (int cell : board->sight_changes)
+    {
+      board->sight_dirty.set(cell, false);
+    }
+    board->sight_changes.clear();
+  }
+  cache.valid = true;
+  cache.radius = sight_radius;
+  cache.mode = sight_mode;
+
+  aimSeenEntities();
+}
+
+// Redirect an orthogonal step between adjacent squares.
+// assumes step is exactly one square orthogonal
+void orthogonalRedirect(BoardId start_board, vect2Di start_pos, vect2Di step, BoardId& end_board, vect2Di& end_pos, Transform& portal_transform, int& portal_color)
+{
+  if (!start_board->onBoard(start_pos))
+  {
+    return;
+  }
+  int cell = start_board->cellIndex(start_pos);
+  int dir = directionIndex(step);
+
+  if (((start_board->portal_dirs.get(cell) >> dir) & 1) == 0)
+  {
+    // Nice and simple
+    end_board = start_board;
+    end_pos = start_pos + step;
+    portal_transform = IDENTITY;
+    portal_color = COLOR_WHITE;
+  }
+  else
+  {
+    // take redirect, transform, and color from the portal
+    const CellStep& cell_step = start_board->step(cell, dir);
+    end_board = BoardId(cell_step.board);
+    if (cell_step.cell >= 0)
+    {
+      end_pos = end_board->cellPos(cell_step.cell);
+    }
+    else
+    {
+      // only the portal itself knows where off the board it goes
+      end_pos = start_pos + step + start_board->getPortal(cell, dir)->offset;
+    }
+    portal_transform = Transform(cell_step.transform);
+    portal_color = cell_step.color;
+  }
+}
+
+// overload to make the color optional
+void orthogonalRedirect(BoardId start_board, vect2Di start_pos, vect2Di step, BoardId& end_board, vect2Di& end_pos, Transform& portal_transform)
+{
+  int color = COLOR_WHITE;
+  return orthogonalRedirect(start_board, start_pos, step, end_board, end_pos, portal_transform, color);
+}
+
+Transform transformFromStep(BoardId start_board, vect2Di start_pos, vect2Di step)
+{
+  Transform transform;
+  vect2Di end_pos;
+  BoardId end_board;
+  orthogonalRedirect(start_board, start_pos, step, end_board, end_pos, transform);
+  return transform;
+}
+
+std::pair<BoardId, vect2Di> posFromStep(BoardId start_board, vect2Di start_pos, vect2Di step)
+{
+  Transform transform;
+  vect2Di end_pos;
+  BoardId end_board;
+  orthogonalRedirect(start_board, start_pos, step, end_board, end_pos, transform);
+  return std::make_pair(end_board, end_pos);
+}
+
+// Walls, plants, and steam all block sight
+bool blocksSight(BoardId board, vect2Di pos)
+{
+  return board->getWall(pos) == true ||
+         board->getPlant(pos) > 0 ||
+         board->getSteam(pos) > 0;
+}
+
+// The rest of a curveCast, from naive square first_step on.  The squares before it have already gone into line, with the last of them
+// (or the start) at current_pos on current_board, after portals adding up to cumulative_transform and current_color.
+void continueCurveCast(Line& line, BoardId current_board, vect2Di current_pos, Transform cumulative_transform, int current_color,
+                       const vect2Di* naive_squares, int first_step, int num_squares, bool is_sight_line)
+{
+  vect2Di next_pos;
+  BoardId next_board;
+
+  for(int step_num = first_step; step_num < num_squares; step_num++)
+  {
+    vect2Di naive_step = naive_squares[step_num] - naive_squares[step_num-1];
+    // This takes into account rotations and flipping caused by portals
+    vect2Di transformed_naive_step = naive_step * cumulative_transform;
+
+    Transform portal_transform;
+    int portal_color = COLOR_WHITE; // white means no change
+    if (!PORTALS_OFF)
+    {
+      orthogonalRedirect(current_board, current_pos, transformed_naive_step, next_board, next_pos, portal_transform, portal_color);
+    }
+    if(portal_color != COLOR_WHITE)
+    {
+      current_color = portal_color;
+    }
+
+    cumulative_transform *= portal_transform;
+
+
+    // If the portal has sent us off a board, stop
+    if (!next_board->onBoard(next_pos))
+    {
+      break;
+    }
+
+    SquareMap square_map;
+
+    square_map.board = next_board;
+    square_map.board_pos = next_pos;
+
+    square_map.line_pos = naive_squares[step_num] - naive_squares[0];
+
+    square_map.transform = cumulative_transform;
+
+    square_map.color = current_color;
+
+    line.push_back(square_map);
+
+    // sight lines don't need to go past the first block
+    if (is_sight_line)
+    {
+      if (blocksSight(next_board, next_pos))
+      {
+        break;
+      }
+    }
+    current_pos = next_pos;
+    current_board = next_board;
+  }
+}
+
+// Follow a chain of orthogonally connected naive squares through any portals, writing the squares actually visited into line.
+// The first naive square is start_pos (it isn't included in the line), and the rest only matter relative to it.
+// The steps are turned by start_transform first, so a shape can be cast in whichever direction the caster faces.
+void curveCast(Line& line, BoardId start_board, vect2Di start_pos, const vect2Di* naive_squares, int num_squares, bool is_sight_line, Transform start_transform)
+{
+  line.clear();
+
+  // This is the rotation and flips of portals travelled to.  Apply to each relative step.
+  // New transforms are multiplied onto the right.
+  Transform cumulative_transform = start_transform;
+
+  int current_color = COLOR_WHITE; // As a sight line goes through a portal, if that portal has a non-white or non-black color, that color overwrites the old one (may have fancier interactions later)
+
+  // Sight lines don't include the starting square.  They do include the ending square.
+  continueCurveCast(line, start_board, start_pos, cumulative_transform, current_color, naive_squares, 1, num_squares, is_sight_line);
+}
+
+// Casts a batch of naive lines that all start at start_pos, turned by start_transform, into lines from line_arena.
+// Line i is squares[starts[i]] up to squares[starts[i+1]], and its first shared[i] naive squares are the same as line i-1's,
+// so that much of it is copied from line i-1 rather than cast again.
+void curveCastBatch(Line** lines, int num_lines, BoardId start_board, vect2Di start_pos, Transform start_transform,
+                    const vect2Di* squares, const int* starts, const int* shared)
+{
+  for (int i = 0; i < num_lines; i++)
+  {
+    Line& line = line_arena.next();
+    lines[i] = &line;
+    const vect2Di* naive_squares = &squares[starts[i]];
+    int num_squares = starts[i+1] - starts[i];
+    // the shared naive squares after the start are the first line squares
+    int copied = i > 0 ? std::max(shared[i] - 1, 0) : 0;
+    if (copied == 0)
+    {
+      curveCast(line, start_board, start_pos, naive_squares, num_squares, false, start_transform);
+      continue;
+    }
+    const Line& prev_line = *lines[i-1];
+    if (prev_line.size() < copied)
+    {
+      // the line before went off a board within the shared part, so this one does too, in the same place
+      line.assignPrefix(prev_line, prev_line.size());
+      continue;
+    }
+    line.assignPrefix(prev_line, copied);
+    SquareMap last = line[copied - 1];
+    continueCurveCast(line, last.board, last.board_pos, last.transform, last.color, naive_squares, copied + 1, num_squares, false);
+  }
+}
+
+// The returned line is from line_arena, so it only lasts until the next turn
+Line& curveCast(BoardId start_board, const std::vector<vect2Di>& naive_squares, bool is_sight_line)
+{
+  Line& line = line_arena.next();
+  curveCast(line, start_board, naive_squares[0], naive_squares.data(), naive_squares.size(), is_sight_line);
+  return line;
+}
+
+// Like curveCast, the line only lasts until the next turn
+Line& lineCast(BoardId board, vect2Di start_board_pos, vect2Di rel_pos, bool is_sight_line)
+{
+  // Kept from cast to cast, so it only allocates for a longer line than any before
+  static std::vector<vect2Di> naive_line;
+  naive_line.resize(orthogonalBresnehamLength(rel_pos));
+  orthogonalBresneham(rel_pos, naive_line.data());
+  Line& line = line_arena.next();
+  curveCast(line, board, start_board_pos, naive_line.data(), naive_line.size(), is_sight_line);
+  return line;
+}
+
+// Shadowcasting works out what the player sees an octant at a time, rather than casting a ray to every square on the edge of sight.
+// It runs in line_pos space (where the player sees things), and finds what is really at each line_pos by following the naive line
+// from the player to it through any portals, the same way a sight ray would.
+// Those are remembered for the rest of the pass, so each square only costs one step from the square before it on its line.
+struct ShadowcastState
+{
+  int radius = -1;
+  // All the grids below are side by side squares centered on the player, indexed by gridIndex
+  int side = 0;
+  // The square just before each one on the naive line to it from the player
+  std::vector<vect2Di> parents;
+  // What is really at each line_pos.  An invalid board means the line there ran off a board.
+  std::vector<SquareMap> mappings;
+  // The pass a mapping was worked out in, and the pass a square was last seen in
+  std::vector<int> mapped_pass;
+  std::vector<int> seen_pass;
+  int pass = 0;
+
+  int gridIndex(vect2Di line_pos)
+  {
+    return (line_pos.x + radius) * side + line_pos.y + radius;
+  }
+};
+
+// Like the ray table, this only changes when the sight radius does
+ShadowcastState& shadowcastState()
+{
+  static ShadowcastState state;
+  if (state.radius != sight_radius)
+  {
+    state.radius = sight_radius;
+    state.side = 2 * sight_radius + 1;
+    int num_squares = state.side * state.side;
+    state.parents.assign(num_squares, vect2Di(0, 0));
+    state.mappings.assign(num_squares, SquareMap());
+    state.mapped_pass.assign(num_squares, 0);
+    state.seen_pass.assign(num_squares, 0);
+    state.pass = 0;
+    std::vector<vect2Di> naive_line;
+    for (int x = -sight_radius; x <= sight_radius; x++)
+    {
+      for (int y = -sight_radius; y <= sight_radius; y++)
+      {
+        if (x != 0 || y != 0)
+        {
+          naive_line.resize(orthogonalBresnehamLength(vect2Di(x, y)));
+          orthogonalBresneham(vect2Di(x, y), naive_line.data());
+          state.parents[state.gridIndex(vect2Di(x, y))] = naive_line[naive_line.size() - 2];
+        }
+      }
+    }
+  }
+  return state;
+}
+
+// What is really at line_pos, found by stepping on from its parent (which is worked out first if it needs to be)
+SquareMap& shadowcastMapping(ShadowcastState& state, vect2Di line_pos)
+{
+  int i = state.gridIndex(line_pos);
+  if (state.mapped_pass[i] == state.pass)
+  {
+    return state.mappings[i];
+  }
+  vect2Di parent_pos = state.parents[i];
+  SquareMap& parent = shadowcastMapping(state, parent_pos);
+  SquareMap& mapping = state.mappings[i];
+  state.mapped_pass[i] = state.pass;
+  mapping.line_pos = line_pos;
+  mapping.board = BoardId();
+  if (!parent.board.valid())
+  {
+    return mapping;
+  }
+
+  // Same as a step of curveCast
+  vect2Di transformed_naive_step = (line_pos - parent_pos) * parent.transform;
+  BoardId next_board = parent.board;
+  vect2Di next_pos = parent.board_pos + transformed_naive_step;
+  Transform portal_transform = IDENTITY;
+  int portal_color = COLOR_WHITE;
+  if (!PORTALS_OFF)
+  {
+    orthogonalRedirect(parent.board, parent.board_pos, transformed_naive_step, next_board, next_pos, portal_transform, portal_color);
+  }
+  if (!next_board->onBoard(next_pos))
+  {
+    return mapping;
+  }
+  mapping.board = next_board;
+  mapping.board_pos = next_pos;
+  mapping.transform = parent.transform * portal_transform;
+  mapping.color = portal_color != COLOR_WHITE ? portal_color : parent.color;
+  return mapping;
+}
+
+// Off the edge of a board counts as blocked too
+bool shadowcastBlocks(ShadowcastState& state, vect2Di line_pos)
+{
+  SquareMap& mapping = shadowcastMapping(state, line_pos);
+  return !mapping.board.valid() || blocksSight(mapping.board, mapping.board_pos);
+}
+
+// The octants share their edges, so only add a square to the sight lines the first time it is seen
+void shadowcastSee(ShadowcastState& state, Line& line, vect2Di line_pos)
+{
+  int i = state.gridIndex(line_pos);
+  if (state.seen_pass[i] == state.pass)
+  {
+    return;
+  }
+  state.seen_pass[i] = state.pass;
+  SquareMap& mapping = shadowcastMapping(state, line_pos);
+  if (!mapping.board.valid())
+  {
+    return;
+  }
+  line.push_back(mapping);
+}
+
+// Recursive shadowcasting of one octant, after Bjorn Bergstrom's on RogueBasin.
+// Rows go out from the player, and each one is scanned from start_slope down to end_slope.
+// When a run of blocking squares starts, the rows past it are cast separately with the narrowed slopes.
+// xx, xy, yx, and yy turn (column, row) in the octant into a line_pos.
+void shadowcastOctant(ShadowcastState& state, Line& line, int row, double start_slope, double end_slope, int xx, int xy, int yx, int yy)
+{
+  if (start_slope < end_slope)
+  {
+    return;
+  }
+  double next_start_slope = start_slope;
+  for (int j = row; j <= state.radius; j++)
+  {
+    bool blocked = false;
+    int dy = -j;
+    for (int dx = -j; dx <= 0; dx++)
+    {
+      double left_slope = (dx - 0.5) / (dy + 0.5);
+      double right_slope = (dx + 0.5) / (dy - 0.5);
+      if (start_slope < right_slope)
+      {
+        continue;
+      }
+      if (end_slope > left_slope)
+      {
+        break;
+      }
+      vect2Di line_pos(dx * xx + dy * xy, dx * yx + dy * yy);
+      shadowcastSee(state, line, line_pos);
+      bool blocks = shadowcastBlocks(state, line_pos);
+      if (blocked)
+      {
+        if (blocks)
+        {
+          next_start_slope = right_slope;
+        }
+        else
+        {
+          blocked = false;
+          start_slope = next_start_slope;
+        }
+      }
+      else if (blocks && j < state.radius)
+      {
+        blocked = true;
+        shadowcastOctant(state, line, j + 1, start_slope, left_slope, xx, xy, yx, yy);
+        next_start_slope = right_slope;
+      }
+    }
+    if (blocked)
+    {
+      break;
+    }
+  }
+}
+
+// xx, xy, yx, yy for each octant
+const int OCTANT_TRANSFORMS[8][4] = {
+  {1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, 1, 0}, {-1, 0, 0, 1},
+  {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1}};
+
+// The player's sight by shadowcasting, as one sight line per octant.
+// The lines aren't lines any more, just every square seen in that octant with where it is seen.
+void shadowcastSight()
+{
+  ShadowcastState& state = shadowcastState();
+  state.pass++;
+
+  int origin = state.gridIndex(vect2Di(0, 0));
+  SquareMap& origin_mapping = state.mappings[origin];
+  origin_mapping.board = player_board;
+  origin_mapping.board_pos = player_pos;
+  origin_mapping.line_pos = vect2Di(0, 0);
+  origin_mapping.transform = IDENTITY;
+  origin_mapping.color = COLOR_WHITE;
+  state.mapped_pass[origin] = state.pass;
+
+  player_sight_lines.resize(8);
+  for (int octant = 0; octant < 8; octant++)
+  {
+    const int* t = OCTANT_TRANSFORMS[octant];
+    player_sight_lines[octant].clear();
+    shadowcastOctant(state, player_sight_lines[octant], 1, 1.0, 0.0, t[0], t[1], t[2], t[3]);
+  }
+}
+
+// The fire, plant, water, and steam updates work on tiles: runs of tile_cells cells of a board (whole columns and then some),
+// or whole boards if tile_cells is 0.  The tiles are all updated at once, spread over the worker threads.
+// A tile may read any board while working out what happens, but then only changes the cells it owns.
+// Anything that reaches out of the tile (across a tile seam or through a portal) is saved up and done after,
+// one tile at a time in order, so the world comes out the same however many threads there are.
+// With whole-board tiles that only leaves portals between boards, and the world comes out as it did before tiling.
+int tile_cells = 0;
+
+struct Tile
+{
+  BoardId board;
+  // Which tile of its board this is, counting along the cell indices
+  int index;
+  // The cells [begin, end) of the board belong to this tile
+  int begin;
+  int end;
+  // The tile's part of the board's taken active cells, taken[first] up to taken[last]
+  int first;
+  int last;
+  // Each tile has its own random stream, so it doesn't matter which thread gets it
+  Rng rng;
+
+  bool owns(BoardId cell_board, int cell)
+  {
+    return cell_board == board && cell >= begin && cell < end;
+  }
+
+  bool owns(const Board* cell_board, int cell)
+  {
+    return owns(cell_board->id, cell);
+  }
+};
+
+// Takes this turn's active cells for one system from every board, and splits them up into tiles that have something to do.
+// tiles is cleared first, so the same vector can be handed in every turn.
+void takeTiles(std::vector<Tile>& tiles, ActiveSet Board::* active_set, RngSubsystem subsystem)
+{
+  tiles.clear();
+  for (int b = 0; b < static_cast<int>(boards.size()); b++)
+  {
+    Board& board = *boards[b];
+    std::vector<int>& taken = (board.*active_set).take();
+    // whole words of the bit planes, so threads never write the same word
+    int size = tile_cells > 0 ? (tile_cells + 63) / 64 * 64 : board.numCells();
+    int num_tiles = (board.numCells() + size - 1) / size;
+    if (num_tiles > 1)
+    {
+      board.unlistChanges();
+    }
+    int first = 0;
+    for (int t = 0; t < num_tiles && first < static_cast<int>(taken.size()); t++)
+    {
+      Tile tile;
+      tile.board = BoardId(b);
+      tile.index = t;
+      tile.begin = t * size;
+      tile.end = std::min(board.numCells(), (t + 1) * size);
+      tile.first = first;
+      tile.last = std::lower_bound(taken.begin() + first, taken.end(), tile.end) - taken.begin();
+      first = tile.last;
+      if (tile.first < tile.last)
+      {
+        tile.rng = Rng::stream(world_seed, subsystem, b, world_tick, t);
+        tiles.push_back(tile);
+      }
+    }
+  }
+}
+
+// Runs body(t) for every tile at once, spread over the worker threads
+template <typename Body>
+void forEachTile(std::vector<Tile>& tiles, const Body& body)
+{
+  workerPool().parallelFor(tiles.size(), body);
+}
+
+// Calls body(cell) for every one of the tile's taken cells that test is true for, in cell order.
+// When most of the tile was taken, the cells are found 64 at a time with test_word (see scan.h) instead of testing them one by one,
+// so test must only be true for cells that were taken, or ones the update has since added to the set.
+// The tests are template arguments so they get inlined into the loops.
+template <bool (Board::*test)(int), uint64_t (Board::*test_word)(int), typename Body>
+void forEachTakenWhere(Tile& tile, const std::vector<int>& taken, const Body& body)
+{
+  Board& board = *tile.board;
+  if ((tile.last - tile.first) * 8 < tile.end - tile.begin)
+  {
+    for (int k = tile.first; k < tile.last; k++)
+    {
+      if ((board.*test)(taken[k]))
+      {
+        body(taken[k]);
+      }
+    }
+    return;
+  }
+  for (int w = tile.begin / 64; w * 64 < tile.end; w++)
+  {
+    uint64_t word = (board.*test_word)(w);
+    while (word != 0)
+    {
+      body(w * 64 + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+}
+
+// Where leaving a cell of board by ORTHOGONALS[dir] ends up, through any portal, like posFromStep.
+// This one works on plain board pointers and cell indices, so the simulation can look at every neighbor without going through boards.
+// A step to the next cell over is an add, and the rest (portals and the edge of the board) come straight from the board's steps.
+// Returns false if the step goes off the board.
+bool stepCell(Board& board, int cell, int dir, Board*& end_board, int& end_cell)
+{
+  if (!board.unusual_steps.get(cell, dir))
+  {
+    end_board = &board;
+    end_cell = cell + board.cell_deltas[dir];
+    return true;
+  }
+  const CellStep& step = board.step(cell, dir);
+  if (step.cell < 0)
+  {
+    return false;
+  }
+  end_board = step.board == board.id.index ? &board : &*BoardId(step.board);
+  end_cell = step.cell;
+  return true;
+}
+
+// Some water or steam leaving a cell of a tile's board by ORTHOGONALS[dir], for end_cell of board index end_board.
+// Where it lands is kept from when the flow was found, since the flows are applied in a shuffled order,
+// and looking each one up again would jump all over the board's steps.
+struct Flow
+{
+  int cell;
+  int end_cell;
+  int magnitude;
+  uint16_t end_board;
+  uint8_t dir;
+};
+
+// The fluids keep their tiles and flow lists from turn to turn, so once those have grown big enough a turn allocates nothing
+struct FlowBuffers
+{
+  std::vector<Tile> tiles;
+  // One list of each per tile
+  std::vector<std::vector<Flow>> flows;
+  std::vector<std::vector<Flow>> pushes;
+
+  // Take this turn's tiles and empty their lists, keeping the space
+  void take(ActiveSet Board::* active_set, RngSubsystem subsystem)
+  {
+    takeTiles(tiles, active_set, subsystem);
+    if (flows.size() < tiles.size())
+    {
+      flows.resize(tiles.size());
+      pushes.resize(tiles.size());
+    }
+    for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+    {
+      flows[t].clear();
+      pushes[t].clear();
+    }
+  }
+};
+
+FlowBuffers steam_buffers;
+FlowBuffers water_buffers;
+
+// Actually flow the steam, if there is still enough of a difference
+void applySteamFlow(Board& start_board, int start_cell, Board& end_board, int end_cell, int magnitude)
+{
+  int start_steam = start_board.getSteam(start_cell);
+  int end_steam = end_board.getSteam(end_cell);
+
+  // if there is still enough of a steam difference to allow a flow
+  if (start_steam > end_steam+1)
+  {
+    // Reduce the flow magnitude if we need to
+    if (end_steam + magnitude > start_steam - magnitude)
+    {
+      magnitude = (start_steam + end_steam)/2 - end_steam;
+    }
+    // A flow worked out against more steam than the end has now can't take it below nothing
+    magnitude = std::max(magnitude, -end_steam);
+    start_board.setSteam(start_cell, start_steam - magnitude);
+    end_board.setSteam(end_cell, end_steam + magnitude);
+  }
+}
+
+void updateSteam()
+{
+  steam_buffers.take(&Board::active_steam, RNG_STEAM);
+  std::vector<Tile>& tiles = steam_buffers.tiles;
+  std::vector<std::vector<Flow>>& flows = steam_buffers.flows;
+
+  // Work out the flows while nothing is changing
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    Board& board = *tile.board;
+    // for every square with enough steam to possibly flow elsewhere
+    forEachTakenWhere<&Board::steamCanFlow, &Board::steamCanFlowWord>(tile, board.active_steam.taken, [&](int i)
+    {
+      int thissteam = board.getSteam(i);
+      // the adjacent squares with less steam, as (direction, steam there)
+      std::pair<int, int> downhills[4];
+      int num_downhills = 0;
+      // where each direction goes
+      Board* adjboards[4];
+      int adjcells[4];
+      // check every adjacent square
+      for (int dir = 0; dir < 4; dir++)
+      {
+        Board* adjboard;
+        int adjcell;
+        // if there can be a flow from here to there
+        if (stepCell(board, i, dir, adjboard, adjcell) &&
+            adjboard->getWall(adjcell)==false &&
+            adjboard->getSteam(adjcell) <= thissteam-2)
+        {
+          downhills[num_downhills++] = std::make_pair(dir, adjboard->getSteam(adjcell));
+          adjboards[dir] = adjboard;
+          adjcells[dir] = adjcell;
+        }
+      }
+      // Now look through the adjacent squares that have less steam, and find out how much steam this square has to give to the other squares for all the squares to have the same amount of steam.
+      int totalSteam = thissteam;
+      for (int d = 0; d < num_downhills; d++)
+      {
+        totalSteam += downhills[d].second;
+      }
+      int avgSteam = totalSteam / (1 + num_downhills);
+      int extrasteam = totalSteam - (avgSteam * (1+num_downhills)); // TODO: make this not be.
+      // extrasteam can be 1, 2, or 3.  We don't need to do anything if it's 1.
+      extrasteam -=1;
+      // shuffle the downhills to prevent direction bias of distribution of extrasteams
+      tile.rng.shuffle(downhills, downhills + num_downhills);
+      for (int d = 0; d < num_downhills; d++)
+      {
+        int magnitude = avgSteam - downhills[d].second;
+        if (extrasteam > 0)
+        {
+          magnitude += 1;
+          extrasteam -= 1;
+        }
+        int dir = downhills[d].first;
+        flows[t].push_back(Flow{i, adjcells[dir], magnitude, static_cast<uint16_t>(adjboards[dir]->id.index), static_cast<uint8_t>(dir)});
+      }
+    });
+  });
+
+  // Then change each tile on its own
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    Board& board = *tile.board;
+    std::vector<int>& steamy = board.active_steam.taken;
+    for (int k = tile.first; k < tile.last; k++)
+    {
+      int i = steamy[k];
+      // if this square has steam and fire, there is no more fire
+      if(board.getSteam(i) > 0 && board.getFire(i) == true)
+      {
+        board.setFire(i, false);
+      }
+      // if this square only has 1 steam, the steam fades away to nothing
+      if(board.getSteam(i) == 1)
+      {
+        board.setSteam(i, 0);
+      }
+    }
+    // randomize the order of attempted flows to prevent directional bias
+    tile.rng.shuffle(flows[t].begin(), flows[t].end());
+    // flows out of the tile wait until every tile is done
+    for (Flow& flow : flows[t])
+    {
+      if (tile.owns(BoardId(flow.end_board), flow.end_cell))
+      {
+        applySteamFlow(board, flow.cell, *BoardId(flow.end_board), flow.end_cell, flow.magnitude);
+      }
+    }
+    // the squares that still have steam stay active
+    forEachTakenWhere<&Board::steamActive, &Board::steamActiveWord>(tile, steamy, [&](int i)
+    {
+      board.active_steam.add(i);
+    });
+  });
+
+  // Flows out of their tiles, in tile order
+  for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+  {
+    Board& board = *tiles[t].board;
+    for (Flow& flow : flows[t])
+    {
+      if (!tiles[t].owns(BoardId(flow.end_board), flow.end_cell))
+      {
+        applySteamFlow(board, flow.cell, *BoardId(flow.end_board), flow.end_cell, flow.magnitude);
+      }
+    }
+  }
+}
+
+// Move one water, if there is still enough of a difference.  Returns true if the water flowed
+bool applyWaterFlow(Board& start_board, int start_cell, Board& end_board, int end_cell)
+{
+  int start_water = start_board.getWater(start_cell);
+  int end_water = end_board.getWater(end_cell);
+
+  // if there is still enough of a water difference to allow a flow
+  if (start_water > end_water+1)
+  {
+    start_board.setWater(start_cell, start_water - 1);
+    end_board.setWater(end_cell, end_water + 1);
+    return true;
+  }
+  return false;
+}
+
+// Flow water
+void updateWater()
+{
+  // Only water that is deep enough to flow or is on fire has anything to do
+  water_buffers.take(&Board::active_water, RNG_WATER);
+  std::vector<Tile>& tiles = water_buffers.tiles;
+  // each flow is one water
+  std::vector<std::vector<Flow>>& flows = water_buffers.flows;
+  // Water flowing out from under the player pushes them, but the player is moved once every tile is done
+  std::vector<std::vector<Flow>>& pushes = water_buffers.pushes;
+
+  // First check for water->steam from fire
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    Board& board = *tile.board;
+    for (int k = tile.first; k < tile.last; k++)
+    {
+      int i = board.active_water.taken[k];
+      // if this square has water and fire, water turns into steam (the steam takes care of putting out fires)
+      if(board.getWater(i) > 0 && board.getFire(i)==true)
+      {
+        board.setWater(i, board.getWater(i) - 1);
+        board.setSteam(i, board.getSteam(i) + STEAM_PER_WATER);
+      }
+    }
+  });
+
+  // Work out the flows while nothing is changing
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    Board& board = *tile.board;
+    // for every square with water deeper than 1
+    forEachTakenWhere<&Board::waterCanFlow, &Board::waterCanFlowWord>(tile, board.active_water.taken, [&](int i)
+    {
+      int thiswater = board.getWater(i);
+      // check every adjacent square
+      for (int dir = 0; dir < 4; dir++)
+      {
+        Board* adjboard;
+        int adjcell;
+        // if there can be a flow from here to there
+        // TODO: different flow rules for shallow vs deep water?
+        if (stepCell(board, i, dir, adjboard, adjcell) &&
+            adjboard->getWall(adjcell)==false &&
+            adjboard->getPlant(adjcell)==0 &&
+            adjboard->getWater(adjcell) <= thiswater-2)
+        {
+          if (tile.rng.range(0, (AVG_WATER_FLOW_TIME-1) * 2) == 0)
+          {
+            flows[t].push_back(Flow{i, adjcell, 1, static_cast<uint16_t>(adjboard->id.index), static_cast<uint8_t>(dir)});
+          }
+        }
+      }
+    });
+  });
+
+  // Then change each tile on its own
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    Board& board = *tile.board;
+    // randomize the order of attempted flows to prevent directional bias
+    tile.rng.shuffle(flows[t].begin(), flows[t].end());
+    // actually flow the water, leaving flows out of the tile until every tile is done
+    for (Flow& flow : flows[t])
+    {
+      if (tile.owns(BoardId(flow.end_board), flow.end_cell) && applyWaterFlow(board, flow.cell, *BoardId(flow.end_board), flow.end_cell))
+      {
+        // Also push the player if the player is there
+        if (board.cellPos(flow.cell) == player_pos)
+        {
+          pushes[t].push_back(flow);
+        }
+      }
+    }
+    forEachTakenWhere<&Board::waterActive, &Board::waterActiveWord>(tile, board.active_water.taken, [&](int i)
+    {
+      board.active_water.add(i);
+    });
+  });
+
+  // Push the player, then flow out of the tiles, in tile order
+  for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+  {
+    Board& board = *tiles[t].board;
+    for (Flow& push : pushes[t])
+    {
+      // an earlier push may have moved them already
+      if (board.cellPos(push.cell) == player_pos)
+      {
+        attemptMove(ORTHOGONALS[push.dir], false);
+      }
+    }
+    for (Flow& flow : flows[t])
+    {
+      if (!tiles[t].owns(BoardId(flow.end_board), flow.end_cell) && applyWaterFlow(board, flow.cell, *BoardId(flow.end_board), flow.end_cell))
+      {
+        if (board.cellPos(flow.cell) == player_pos)
+        {
+          attemptMove(ORTHOGONALS[flow.dir], false);
+        }
+      }
+    }
+  }
+}
+
+// Fire and plants keep their tiles and the squares they spread to from turn to turn too, like FlowBuffers
+struct SpreadBuffers
+{
+  std::vector<Tile> tiles;
+  // One list per tile
+  std::vector<std::vector<std::pair<BoardId, int>>> spreads;
+
+  // Take this turn's tiles and empty their lists, keeping the space
+  void take(ActiveSet Board::* active_set, RngSubsystem subsystem)
+  {
+    takeTiles(tiles, active_set, subsystem);
+    if (spreads.size() < tiles.size())
+    {
+      spreads.resize(tiles.size());
+    }
+    for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+    {
+      spreads[t].clear();
+    }
+  }
+};
+
+SpreadBuffers fire_buffers;
+SpreadBuffers plant_buffers;
+
+// fire spreading and damaging plants
+void updateFire()
+{
+  fire_buffers.take(&Board::active_fire, RNG_FIRE);
+  std::vector<Tile>& tiles = fire_buffers.tiles;
+  std::vector<std::vector<std::pair<BoardId, int>>>& newFires = fire_buffers.spreads;
+  auto owns = [](Tile& tile, std::pair<BoardId, int>& loc)
+  {
+    return tile.owns(loc.first, loc.second);
+  };
+
+  // Find where the fires spread while nothing is changing
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    BoardId board = tile.board;
+    // for every square that has a fire, and a plant that will still be there after the fire damages it
+    // Fire without fuel can't spread
+    forEachTakenWhere<&Board::fireCanSpread, &Board::fireCanSpreadWord>(tile, board->active_fire.taken, [&](int i)
+    {
+      // check every adjacent square
+      for (int dir = 0; dir < 4; dir++)
+      {
+        Board* adjboard;
+        int adjcell;
+        // if the space has no fire, the fire may spread
+        if (stepCell(*board, i, dir, adjboard, adjcell) &&
+            adjboard->getWall(adjcell) == false &&
+            adjboard->getFire(adjcell) == false)
+        {
+          if (tile.rng.range(0, (AVG_FIRE_SPREAD_TIME-1) * 2) == 0)
+          {
+            newFires[t].push_back(std::make_pair(adjboard->id, adjcell));
+          }
+        }
+      }
+    });
+  });
+
+  // Then burn each tile on its own
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    BoardId board = tile.board;
+    std::vector<int>& burning = board->active_fire.taken;
+    for (int k = tile.first; k < tile.last; k++)
+    {
+      int i = burning[k];
+      if(board->getFire(i) == true)
+      {
+        // apply damage to the current plant, maybe destroying it and putting out the fire
+        if (board->getPlant(i) > 0)
+        {
+          board->setPlant(i, board->getPlant(i) - 1);
+        }
+        if (board->getPlant(i) == 0)
+        {
+          board->setFire(i, false);
+        }
+      }
+    }
+    // actually spawn the fires in the selected locations, leaving the ones out of the tile until every tile is done
+    for (auto& loc : newFires[t])
+    {
+      if (owns(tile, loc))
+      {
+        loc.first->setFire(loc.second, true);
+      }
+    }
+    forEachTakenWhere<&Board::fireActive, &Board::fireActiveWord>(tile, burning, [&](int i)
+    {
+      board->active_fire.add(i);
+    });
+  });
+
+  for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+  {
+    for (auto& loc : newFires[t])
+    {
+      if (!owns(tiles[t], loc))
+      {
+        loc.first->setFire(loc.second, true);
+      }
+    }
+  }
+}
+
+// go through all the plants, and grow new ones or kill off old ones as rules dictate
+// For now, simple expansion
+void updatePlants()
+{
+  plant_buffers.take(&Board::active_plants, RNG_PLANTS);
+  std::vector<Tile>& tiles = plant_buffers.tiles;
+  std::vector<std::vector<std::pair<BoardId, int>>>& whereToSpawnPlants = plant_buffers.spreads;
+  auto owns = [](Tile& tile, std::pair<BoardId, int>& loc)
+  {
+    return tile.owns(loc.first, loc.second);
+  };
+
+  // Find where the plants spread while nothing is changing
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    BoardId board = tile.board;
+    // for every square with a plant THAT IS NOT ON FIRE
+    forEachTakenWhere<&Board::plantCanSpread, &Board::plantCanSpreadWord>(tile, board->active_plants.taken, [&](int i)
+    {
+      // check every adjacent square
+      for (int dir = 0; dir < 4; dir++)
+      {
+        Board* adjboard;
+        int adjcell;
+        // if the space is empty
+        if (stepCell(*board, i, dir, adjboard, adjcell) && cellIsWalkable(*adjboard, adjcell))
+        {
+          if (tile.rng.range(0, (AVG_PLANT_SPAWN_TIME-1) * 2) == 0)
+          {
+            whereToSpawnPlants[t].push_back(std::make_pair(adjboard->id, adjcell));
+          }
+        }
+      }
+    });
+  });
+
+  // Then grow each tile on its own
+  // createPlant checks the square is still empty, because we don't want to try to double spawn a plant (a square with 2 adjacent plants has 2 chances to spawn)
+  forEachTile(tiles, [&](int t)
+  {
+    Tile& tile = tiles[t];
+    BoardId board = tile.board;
+    for (auto& loc : whereToSpawnPlants[t])
+    {
+      if (owns(tile, loc))
+      {
+        createPlant(*loc.first, loc.second);
+      }
+    }
+    forEachTakenWhere<&Board::plantActive, &Board::plantActiveWord>(tile, board->active_plants.taken, [&](int i)
+    {
+      board->active_plants.add(i);
+    });
+  });
+
+  for (int t = 0; t < static_cast<int>(tiles.size()); t++)
+  {
+    for (auto& loc : whereToSpawnPlants[t])
+    {
+      if (!owns(tiles[t], loc))
+      {
+        createPlant(*loc.first, loc.second);
+      }
+    }
+  }
+}
+
+// A hash of the state of the world, for checking that two runs came out the same
+uint64_t worldChecksum()
+{
+  uint64_t hash = mixBits(world_tick);
+  auto add = [&](uint64_t value) { hash = mixBits(hash ^ value); };
+  for (std::shared_ptr<Board>& board : boards)
+  {
+    for (uint64_t word : board->wall.words)
+      add(word);
+    for (uint64_t word : board->fire.words)
+      add(word);
+    for (int i = 0; i < board->numCells(); i++)
+    {
+      add(board->getWater(i) | (board->getSteam(i) << 16) | (static_cast<uint64_t>(board->getPlant(i)) << 32));
+    }
+    for (int k = 0; k < board->entities.size(); k++)
+    {
+      add(board->cellIndex(board->entities.pos[k]));
+      add(directionIndex(board->entities.faced_direction[k]));
+    }
+  }
+  add(player_board->cellIndex(player_pos));
+  return hash;
+}
+
+// Apply one key of player input.  Returns true if the laser is held down this turn.
+bool handleInput(int in)
+{
+  bool laser_fired = false;
+  if (in == ' ')
+  {
+    laser_fired = true;
+  }
+  else if (in == 'f')
+  {
+    shootArrow();
+  }
+  else if (in == 'b')
+  {
+    buildTurret();
+  }
+  else if (in == 'v')
+  {
+    // switch between the ways of seeing, to compare them
+    sight_mode = sight_mode == SIGHT_RAYS ? SIGHT_SHADOWCAST : SIGHT_RAYS;
+  }
+  else if (in == 'h')
+    attemptMove(vect2Di(-1, 0)*player_transform);
+  else if (in == 'j')
+    attemptMove(vect2Di(0, -1)*player_transform);
+  else if (in == 'k')
+    attemptMove(vect2Di(0, 1)*player_transform);
+  else if (in == 'l')
+    attemptMove(vect2Di(1, 0)*player_transform);
+  /*
+  else if (in == 'y')
+    attemptMove(vect2Di(-1, 1));
+  else if (in == 'u')
+    attemptMove(vect2Di(1, 1));
+  else if (in == 'b')
+    attemptMove(vect2Di(-1, -1));
+  else if (in == 'n')
+    attemptMove(vect2Di(1, -1));
+    */
+  return laser_fired;
+}
+
+// Adds the time since the last lap to a phase, if anyone is keeping track
+struct PhaseTimer
+{
+  PhaseTimes* times;
+  std::chrono::steady_clock::time_point lap_start;
+
+  PhaseTimer(PhaseTimes* times)
+    : times(times)
+  {
+    if (times != nullptr)
+    {
+      lap_start = std::chrono::steady_clock::now();
+    }
+  }
+
+  void lap(Phase phase)
+  {
+    if (times != nullptr)
+    {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      times->seconds[phase] += std::chrono::duration<double>(now - lap_start).count();
+      lap_start = now;
+    }
+  }
+};
+
+// Advance the world by one turn
+void tickWorld(bool laser_fired, PhaseTimes* times = nullptr)
+{
+  line_arena.reset();
+  if (!laser_fired)
+  {
+    consecutive_laser_rounds = 0;
+  }
+  else
+  {
+    consecutive_laser_rounds++;
+  }
+
+  PhaseTimer timer(times);
+  updateFire();
+  timer.lap(PHASE_FIRE);
+  if (laser_fired)
+  {
+    shootLaser();
+  }
+  timer.lap(PHASE_LASER);
+  updatePlants();
+  timer.lap(PHASE_PLANTS);
+  updateWater();
+  timer.lap(PHASE_WATER);
+  updateSteam();
+  timer.lap(PHASE_STEAM);
+  updateSightLines();
+  timer.lap(PHASE_SIGHT);
+  updateEntities();
+  timer.lap(PHASE_ENTITIES);
+  world_tick++;
+}
+
+#endif